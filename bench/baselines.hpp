@@ -0,0 +1,71 @@
+#pragma once
+
+#include "priority_queue.hpp" // for LOCKFREE_PREEMPTION_POINT
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+/* Lock-based queues with the lockfree::priority_queue interface, for comparison. */
+
+namespace baseline {
+
+  // test-and-test-and-set lock that never yields, so a preempted holder stalls every waiter for its time slice
+  class spinlock {
+    std::atomic< bool > locked{ false };
+  public:
+    void lock( ) {
+      while ( locked.exchange( true, std::memory_order_acquire ) ) {
+	while ( locked.load( std::memory_order_relaxed ) );
+      }
+    };
+    void unlock( ) {
+      locked.store( false, std::memory_order_release );
+    };
+  };
+
+  // std::priority_queue behind a Lock, keeping FIFO order among equal keys like the list does
+  template< class T, typename K, class Lock = std::mutex >
+  class locked_priority_queue {
+    struct entry {
+      K key;
+      std::uint64_t order;
+      T *value;
+      bool operator<( const entry &other ) const {
+	return key < other.key || ( !( other.key < key ) && order > other.order );
+      };
+    };
+    std::priority_queue< entry > heap;
+    std::uint64_t inserted = 0;
+    Lock lock;
+  public:
+    typedef T value_type;
+    typedef K key_type;
+
+    void insert( T *value, K key ) {
+      std::lock_guard< Lock > guard( lock );
+      LOCKFREE_PREEMPTION_POINT( ); // stalling here holds everyone else up
+      heap.push( entry{ key, inserted++, value } );
+    };
+    T * pop( K key ) {
+      std::lock_guard< Lock > guard( lock );
+      LOCKFREE_PREEMPTION_POINT( );
+      if ( heap.empty( ) || key > heap.top( ).key ) return nullptr;
+      T *value = heap.top( ).value;
+      heap.pop( );
+      return value;
+    };
+    T * pop( ) {
+      std::lock_guard< Lock > guard( lock );
+      LOCKFREE_PREEMPTION_POINT( );
+      if ( heap.empty( ) ) return nullptr;
+      T *value = heap.top( ).value;
+      heap.pop( );
+      return value;
+    };
+  };
+
+}
@@ -0,0 +1,91 @@
+// Overload: producers outpace consumers, with and without codel_queue shedding the lowest priority work.
+//   g++ -std=c++17 -O2 -pthread -DLOCKFREE_SOJOURN -I.. codel.cpp -o codel && ./codel [ seconds = 2 ] [ offered items/s = 15000 ] [ service us = 100 ]
+// Two consumers each take service us per item, so offered loads above 2e6 / service us pile up.
+
+#include "codel_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint32_t key;
+
+struct job {
+  key priority;
+};
+
+// upper edge of the bucket holding quantile q, in microseconds
+template< class Histogram >
+static double quantile( const Histogram &histogram, double q ) {
+  std::uint64_t total = 0, seen = 0;
+  for ( std::uint64_t count : histogram ) total += count;
+  for ( std::size_t i = 0; i < histogram.size( ); ++i ) {
+    if ( ( seen += histogram[ i ] ) >= q * total && total ) return std::ldexp( 1.0, i + 1 ) / 1000;
+  }
+  return 0;
+}
+
+template< class Queue >
+static void run( const char *name, Queue &queue, double seconds, double rate, std::chrono::microseconds service ) {
+  const std::size_t consumers = 2;
+  std::atomic< bool > stop{ false };
+  std::atomic< std::uint64_t > served{ 0 }, served_top{ 0 }, offered{ 0 };
+  std::vector< std::thread > workers;
+  for ( std::size_t i = 0; i < consumers; ++i ) {
+    workers.emplace_back( [ & ] {
+	while ( !stop.load( std::memory_order_relaxed ) ) {
+	  job *item = queue.pop( );
+	  if ( !item ) {
+	    std::this_thread::yield( );
+	    continue;
+	  }
+	  bench_clock::time_point done = bench_clock::now( ) + service;
+	  while ( bench_clock::now( ) < done ); // the work
+	  served += 1;
+	  served_top += item->priority == 9;
+	  delete item;
+	}
+      } );
+  }
+  workers.emplace_back( [ & ] { // paced in 1 ms steps
+      std::mt19937 random( 1 );
+      bench_clock::time_point next = bench_clock::now( );
+      double owed = 0;
+      while ( !stop.load( std::memory_order_relaxed ) ) {
+	for ( owed += rate / 1000; owed >= 1; owed -= 1 ) {
+	  key priority = random( ) % 10;
+	  queue.insert( new job{ priority }, priority );
+	  offered += 1;
+	}
+	std::this_thread::sleep_until( next += std::chrono::milliseconds( 1 ) );
+      }
+    } );
+  std::this_thread::sleep_for( std::chrono::duration< double >( seconds ) );
+  stop = true;
+  for ( std::thread &worker : workers ) worker.join( );
+  auto histogram = queue.sojourn_histogram( ); // served and shed alike
+  std::printf( "%-14s %9llu %9llu %9llu %9llu %10.0f %10.0f\n", name, static_cast< unsigned long long >( offered.load( ) ),
+	       static_cast< unsigned long long >( served.load( ) ), static_cast< unsigned long long >( served_top.load( ) ),
+	       static_cast< unsigned long long >( offered - served ), quantile( histogram, 0.5 ), quantile( histogram, 0.99 ) );
+}
+
+int main( int argc, char **argv ) {
+  double seconds = argc > 1 ? std::atof( argv[ 1 ] ) : 2;
+  double rate = argc > 2 ? std::atof( argv[ 2 ] ) : 15000;
+  std::chrono::microseconds service( argc > 3 ? std::atoi( argv[ 3 ] ) : 100 );
+  std::printf( "%.0f items/s offered for %.1f s, 2 consumers at %lld us each\n", rate, seconds, static_cast< long long >( service.count( ) ) );
+  std::printf( "%-14s %9s %9s %9s %9s %10s %10s\n", "queue", "offered", "served", "top prio", "left/shed", "p50 us", "p99 us" );
+  {
+    lockfree::priority_queue< job, key > plain;
+    run( "no AQM", plain, seconds, rate, service );
+  }
+  {
+    lockfree::codel_queue< job, key > codel;
+    run( "codel", codel, seconds, rate, service );
+    std::printf( "%-14s %llu shed\n", "", static_cast< unsigned long long >( codel.shed_count( ) ) );
+  }
+  return 0;
+}
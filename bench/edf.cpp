@@ -0,0 +1,103 @@
+// Deadline scheduling: a hand-rolled loop polling priority_queue against edf_executor, on bursty load with idle gaps.
+//   g++ -std=c++17 -O2 -pthread -I.. edf.cpp -o edf && ./edf [ seconds = 2 ] [ tasks/s while busy = 20000 ] [ work us = 20 ] [ workers = 2 ]
+// Load comes in 50 ms bursts every 100 ms, each task due 1 to 10 ms after it is submitted. CPU is the process total, submitter included.
+
+#include "edf_executor.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <thread>
+
+typedef lockfree::edf_executor::clock bench_clock;
+
+static void spin( std::chrono::microseconds work ) {
+  bench_clock::time_point done = bench_clock::now( ) + work;
+  while ( bench_clock::now( ) < done );
+}
+
+// what teams write by hand: workers polling the queue, keyed by the complement of the deadline
+class polling {
+  struct task {
+    std::function< void( ) > run;
+    bench_clock::time_point deadline;
+  };
+  lockfree::priority_queue< task, std::uint64_t > queue;
+  std::atomic< bool > stop{ false };
+  std::atomic< std::uint64_t > completed{ 0 }, missed{ 0 }, late{ 0 };
+  std::vector< std::thread > workers;
+public:
+  explicit polling( std::size_t threads ) {
+    for ( std::size_t i = 0; i < threads; ++i ) {
+      workers.emplace_back( [ this ] {
+	  while ( true ) {
+	    task *next = queue.pop( );
+	    if ( !next ) {
+	      if ( stop.load( ) ) return;
+	      std::this_thread::yield( );
+	      continue;
+	    }
+	    next->run( );
+	    bench_clock::duration over = bench_clock::now( ) - next->deadline;
+	    completed += 1;
+	    if ( over.count( ) > 0 ) {
+	      missed += 1;
+	      late += std::chrono::duration_cast< std::chrono::nanoseconds >( over ).count( );
+	    }
+	    delete next;
+	  }
+	} );
+    }
+  };
+  ~polling( ) {
+    stop = true;
+    for ( std::thread &worker : workers ) worker.join( );
+  };
+  void submit( std::function< void( ) > run, bench_clock::time_point deadline ) {
+    queue.insert( new task{ std::move( run ), deadline }, ~static_cast< std::uint64_t >( deadline.time_since_epoch( ).count( ) ) );
+  };
+  lockfree::edf_stats statistics( ) const {
+    return { completed.load( ), missed.load( ), 0, std::chrono::nanoseconds( late.load( ) ), std::chrono::nanoseconds( 0 ) };
+  };
+};
+
+template< class Executor >
+static void run( const char *name, double seconds, double rate, std::chrono::microseconds work, std::size_t threads ) {
+  std::clock_t cpu = std::clock( );
+  lockfree::edf_stats stats;
+  {
+    Executor executor( threads );
+    std::mt19937 random( 7 );
+    std::uniform_int_distribution< int > slack( 1000, 10000 ); // us
+    bench_clock::time_point start = bench_clock::now( ), next = start;
+    double owed = 0;
+    while ( next - start < std::chrono::duration< double >( seconds ) ) { // paced in 1 ms steps
+      bool busy = ( next - start ) % std::chrono::milliseconds( 100 ) < std::chrono::milliseconds( 50 );
+      for ( owed += busy ? rate / 1000 : 0; owed >= 1; owed -= 1 ) {
+	executor.submit( [ work ] { spin( work ); }, bench_clock::now( ) + std::chrono::microseconds( slack( random ) ) );
+      }
+      std::this_thread::sleep_until( next += std::chrono::milliseconds( 1 ) );
+    }
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) ); // let the last burst finish
+    stats = executor.statistics( );
+  }
+  double cpu_seconds = double( std::clock( ) - cpu ) / CLOCKS_PER_SEC;
+  std::printf( "%-14s %7zu %10llu %8.2f%% %12.1f %9.2f %8llu\n", name, threads, static_cast< unsigned long long >( stats.completed ),
+	       stats.completed ? 100.0 * stats.missed / stats.completed : 0.0,
+	       stats.missed ? std::chrono::duration< double, std::micro >( stats.total_lateness ).count( ) / stats.missed : 0.0,
+	       cpu_seconds, static_cast< unsigned long long >( stats.parks ) );
+}
+
+int main( int argc, char **argv ) {
+  double seconds = argc > 1 ? std::atof( argv[ 1 ] ) : 2;
+  double rate = argc > 2 ? std::atof( argv[ 2 ] ) : 20000;
+  std::chrono::microseconds work( argc > 3 ? std::atoi( argv[ 3 ] ) : 20 );
+  std::size_t threads = argc > 4 ? std::atoi( argv[ 4 ] ) : 2;
+  std::printf( "%.1f s, %.0f tasks/s in bursts, %lld us each\n", seconds, rate, static_cast< long long >( work.count( ) ) );
+  std::printf( "%-14s %7s %10s %9s %12s %9s %8s\n", "executor", "workers", "completed", "missed", "mean late us", "CPU s", "parks" );
+  run< polling >( "polling", seconds, rate, work, threads );
+  run< lockfree::edf_executor >( "edf_executor", seconds, rate, work, threads );
+  return 0;
+}
@@ -0,0 +1,79 @@
+// The hold model: every thread pops the earliest event and schedules a follow-up, as pop( ) + insert( ) and as pushpop( ).
+//   g++ -std=c++17 -O2 -pthread -I.. hold.cpp -o hold && ./hold [ seconds per run = 1 ] [ queue size = 256 ]
+
+#include "priority_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint64_t key;
+
+static key key_for( std::uint64_t time ) {
+  return ~time; // earliest first
+}
+
+template< bool Fused >
+static void run( const char *name, std::size_t threads, double seconds, std::size_t size ) {
+  lockfree::priority_queue< std::uint64_t, key > queue;
+  std::vector< std::uint64_t > events( size + threads ); // each thread has one in hand for pushpop
+  std::mt19937_64 random( 11 );
+  std::exponential_distribution< double > gap( 1.0 / 1000 );
+  for ( std::size_t i = 0; i < size; ++i ) queue.insert( &events[ i ], key_for( events[ i ] = gap( random ) ) );
+
+  std::atomic< bool > start{ false }, stop{ false };
+  std::atomic< std::size_t > holds{ 0 }, kept{ 0 };
+  std::vector< std::thread > workers;
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t id ) {
+	std::mt19937_64 random( id );
+	std::exponential_distribution< double > gap( 1.0 / 1000 );
+	std::uint64_t *event = &events[ size + id ], *next;
+	std::size_t done = 0, own = 0;
+	*event = 0;
+	while ( !start.load( std::memory_order_acquire ) ) std::this_thread::yield( );
+	if ( !Fused ) event = queue.pop( );
+	while ( !stop.load( std::memory_order_relaxed ) ) {
+	  if ( Fused ) { // the event in hand is rescheduled and the earliest one comes back, maybe itself
+	    *event += gap( random );
+	    next = queue.pushpop( event, key_for( *event ) );
+	    own += next == event;
+	    event = next;
+	  } else if ( event ) {
+	    *event += gap( random );
+	    queue.insert( event, key_for( *event ) );
+	    event = queue.pop( );
+	  }
+	  ++done;
+	}
+	if ( Fused || event ) queue.insert( event, key_for( *event ) );
+	holds += done;
+	kept += own;
+      }, i );
+  }
+  bench_clock::time_point begin = bench_clock::now( );
+  start.store( true, std::memory_order_release );
+  std::this_thread::sleep_for( std::chrono::duration< double >( seconds ) );
+  stop = true;
+  for ( std::thread &worker : workers ) worker.join( );
+  double elapsed = std::chrono::duration< double >( bench_clock::now( ) - begin ).count( );
+  lockfree::memory_stats memory = queue.memory_usage( );
+  while ( queue.pop( ) );
+  std::printf( "%-14s %7zu %10.2f %9.1f%% %10zu\n", name, threads, holds / elapsed / 1e6,
+	       holds ? 100.0 * kept / holds : 0.0, memory.pool_bytes / ( memory.sentinel_bytes / 2 ) );
+}
+
+int main( int argc, char **argv ) {
+  double seconds = argc > 1 ? std::atof( argv[ 1 ] ) : 1;
+  std::size_t size = argc > 2 ? std::atoi( argv[ 2 ] ) : 256;
+  std::printf( "%zu events, %.1f s per run\n", size, seconds );
+  std::printf( "%-14s %7s %10s %10s %10s\n", "operation", "threads", "Mholds/s", "kept", "nodes" );
+  for ( std::size_t threads : { 1, 2, 4, 8 } ) {
+    run< false >( "pop + insert", threads, seconds, size );
+    run< true >( "pushpop", threads, seconds, size );
+  }
+  return 0;
+}
@@ -0,0 +1,73 @@
+// At-least-once draining: plain pop( ) against lease_pop( ) + ack( ), with some consumers dropping leases as if they crashed.
+//   g++ -std=c++17 -O2 -pthread -I.. lease.cpp -o lease && ./lease [ items = 20000 ] [ dropped per 1000 leases = 10 ] [ lease us = 500 ]
+
+#include "priority_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint32_t key;
+
+template< bool Leased >
+static void run( const char *name, std::size_t threads, std::size_t items, std::size_t dropped, std::chrono::microseconds timeout ) {
+  lockfree::priority_queue< key, key > queue;
+  std::vector< key > payloads( items );
+  std::vector< std::atomic< std::uint8_t > > done( items );
+  std::mt19937 random( 5 );
+  std::vector< std::pair< key *, key > > fill;
+  for ( key &payload : payloads ) fill.emplace_back( &payload, payload = random( ) );
+  queue.assign( fill.begin( ), fill.end( ) );
+
+  std::atomic< std::size_t > finished{ 0 }, delivered{ 0 }, lost{ 0 };
+  std::vector< std::thread > workers;
+  bench_clock::time_point start = bench_clock::now( );
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t id ) {
+	std::mt19937 random( id );
+	std::size_t local_delivered = 0;
+	while ( finished.load( std::memory_order_relaxed ) < items ) {
+	  key *item;
+	  typename lockfree::priority_queue< key, key >::lease lease;
+	  if ( Leased ) item = ( lease = queue.lease_pop( timeout ) ).value;
+	  else item = queue.pop( );
+	  if ( !item ) {
+	    if ( !Leased ) break; // nothing comes back
+	    std::this_thread::yield( ); // the rest are out on lease
+	    continue;
+	  }
+	  ++local_delivered;
+	  if ( random( ) % 1000 < dropped ) { // crashed while processing it
+	    if ( !Leased ) lost += 1;
+	    continue;
+	  }
+	  if ( Leased && !queue.ack( lease ) ) continue; // too slow, someone else has it now
+	  done[ item - payloads.data( ) ] += 1;
+	  finished += 1;
+	}
+	delivered += local_delivered;
+      }, i );
+  }
+  for ( std::thread &worker : workers ) worker.join( );
+  double seconds = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+  std::size_t twice = 0;
+  for ( std::atomic< std::uint8_t > &count : done ) twice += count > 1;
+  std::printf( "%-14s %7zu %10.2f %10zu %8zu %8zu\n", name, threads, items / seconds / 1e6, delivered.load( ) - items,
+	       lost.load( ), twice );
+}
+
+int main( int argc, char **argv ) {
+  std::size_t items = argc > 1 ? std::atoi( argv[ 1 ] ) : 20000;
+  std::size_t dropped = argc > 2 ? std::atoi( argv[ 2 ] ) : 10;
+  std::chrono::microseconds timeout( argc > 3 ? std::atoi( argv[ 3 ] ) : 500 );
+  std::printf( "%zu items, %zu in 1000 dropped, %lld us leases\n", items, dropped, static_cast< long long >( timeout.count( ) ) );
+  std::printf( "%-14s %7s %10s %10s %8s %8s\n", "consumer", "threads", "Mitems/s", "redelivered", "lost", "twice" );
+  for ( std::size_t threads : { 1, 2, 4, 8 } ) {
+    run< false >( "pop", threads, items, dropped, timeout );
+    run< true >( "lease + ack", threads, items, dropped, timeout );
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+// k-way merge of sorted log streams: lockfree::merge_streams with 1 to 8 consumers against a std::priority_queue merge.
+//   g++ -std=c++17 -O2 -pthread -I.. merge.cpp -o merge && ./merge [ streams = 256 ] [ records per stream = 5000 ] [ batch = 256 ]
+
+#include "merge_streams.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct log_record {
+  std::uint64_t time; // ns
+  std::uint64_t payload;
+};
+
+struct time_of {
+  std::uint64_t operator( )( const log_record &record ) const { return record.time; };
+};
+
+typedef lockfree::iterator_reader< std::vector< log_record >::const_iterator > reader;
+
+static double seconds_since( bench_clock::time_point start ) {
+  return std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+}
+
+int main( int argc, char **argv ) {
+  std::size_t streams = argc > 1 ? std::atoi( argv[ 1 ] ) : 256;
+  std::size_t records = argc > 2 ? std::atoi( argv[ 2 ] ) : 5000;
+  std::size_t batch = argc > 3 ? std::atoi( argv[ 3 ] ) : 256;
+  std::vector< std::vector< log_record > > inputs( streams );
+  std::mt19937_64 random( 3 );
+  std::uint64_t expected = 0;
+  for ( std::size_t i = 0; i < streams; ++i ) {
+    std::uint64_t time = random( ) % 1000000;
+    for ( std::size_t j = 0; j < records; ++j ) {
+      time += random( ) % 2000; // bursty, so streams overtake each other
+      inputs[ i ].push_back( log_record{ time, i << 32 | j } );
+      expected += time ^ inputs[ i ].back( ).payload;
+    }
+  }
+  std::size_t total = streams * records;
+  std::printf( "%zu streams x %zu records, batch %zu\n", streams, records, batch );
+  std::printf( "%-24s %9s %9s %8s\n", "merge", "seconds", "Mrec/s", "check" );
+
+  { // baseline: one thread, a heap of ( time, stream ) over the stream cursors
+    typedef std::pair< std::uint64_t, std::size_t > head;
+    std::priority_queue< head, std::vector< head >, std::greater< head > > heap;
+    std::vector< std::size_t > cursor( streams, 0 );
+    std::uint64_t sum = 0, last = 0;
+    bool sorted = true;
+    bench_clock::time_point start = bench_clock::now( );
+    for ( std::size_t i = 0; i < streams; ++i ) if ( records ) heap.emplace( inputs[ i ][ 0 ].time, i );
+    while ( !heap.empty( ) ) {
+      std::size_t i = heap.top( ).second;
+      heap.pop( );
+      const log_record &record = inputs[ i ][ cursor[ i ]++ ];
+      sorted &= record.time >= last;
+      last = record.time;
+      sum += record.time ^ record.payload;
+      if ( cursor[ i ] < records ) heap.emplace( inputs[ i ][ cursor[ i ] ].time, i );
+    }
+    double seconds = seconds_since( start );
+    std::printf( "%-24s %9.3f %9.2f %8s\n", "std::priority_queue", seconds, total / seconds / 1e6,
+		 sum == expected && sorted ? "ok" : "WRONG" );
+  }
+
+  for ( std::size_t consumers : { 1, 2, 4, 8 } ) {
+    std::vector< reader > readers;
+    for ( const std::vector< log_record > &input : inputs ) readers.push_back( lockfree::make_iterator_reader( input.cbegin( ), input.cend( ) ) );
+    std::atomic< std::uint64_t > sum{ 0 }, count{ 0 }, inversions{ 0 };
+    bench_clock::time_point start = bench_clock::now( );
+    lockfree::merge_streams< reader, time_of > merge( std::move( readers ), batch );
+    std::vector< std::thread > workers;
+    for ( std::size_t i = 0; i < consumers; ++i ) {
+      workers.emplace_back( [ & ] {
+	  log_record record;
+	  std::uint64_t local_sum = 0, local_count = 0, local_inversions = 0, last = 0;
+	  while ( merge.pop( record ) ) { // each consumer sees its share in order, bar refills racing
+	    local_inversions += record.time < last;
+	    last = record.time;
+	    local_sum += record.time ^ record.payload;
+	    ++local_count;
+	  }
+	  sum += local_sum;
+	  count += local_count;
+	  inversions += local_inversions;
+	} );
+    }
+    for ( std::thread &worker : workers ) worker.join( );
+    double seconds = seconds_since( start );
+    char name[ 32 ];
+    std::snprintf( name, sizeof( name ), "merge_streams x%zu", consumers );
+    std::printf( "%-24s %9.3f %9.2f %8s", name, seconds, total / seconds / 1e6,
+		 sum == expected && count == total && ( consumers > 1 || !inversions ) ? "ok" : "WRONG" );
+    if ( inversions ) std::printf( "  %llu out of order", static_cast< unsigned long long >( inversions.load( ) ) );
+    std::printf( "\n" );
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Throughput and tail latency with 1x to 8x more threads than cores: lock-free queue against mutex and spinlock baselines.
+//   g++ -std=c++17 -O2 -pthread -I.. oversubscription.cpp -o oversubscription && ./oversubscription [ seconds per run = 1 ] [ prefill = 256 ]
+// Build with -DLOCKFREE_INJECT_PREEMPTION=64 as well to stall threads inside operations ( and inside the baselines' locks ).
+
+#include "priority_queue.hpp"
+#include "baselines.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint64_t key;
+
+struct run_result {
+  double ops_per_second;
+  double p50, p99, p999, max; // microseconds per operation
+};
+
+// every thread alternates insert and pop( ) on a prefilled queue until the time is up
+// inserts walk the list, so keep prefill small to measure contention rather than list length
+template< class Queue >
+static run_result run( std::size_t threads, double seconds, std::size_t prefill ) {
+  Queue queue;
+  std::vector< key > payloads( prefill );
+  std::mt19937_64 random( 7 );
+  for ( key &payload : payloads ) queue.insert( &payload, random( ) % 1024 );
+
+  std::atomic< bool > start{ false }, stop{ false };
+  std::vector< std::vector< std::uint32_t > > latencies( threads ); // nanoseconds
+  std::vector< std::thread > workers;
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t id ) {
+	std::mt19937_64 random( id );
+	std::vector< std::uint32_t > &latency = latencies[ id ];
+	latency.reserve( 1 << 20 );
+	key payload = id;
+	while ( !start.load( std::memory_order_acquire ) ) std::this_thread::yield( );
+	for ( std::size_t op = 0; !stop.load( std::memory_order_relaxed ); ++op ) {
+	  key k = random( ) % 1024;
+	  bench_clock::time_point begin = bench_clock::now( );
+	  if ( op & 1 ) queue.pop( );
+	  else queue.insert( &payload, k );
+	  std::chrono::nanoseconds took = bench_clock::now( ) - begin;
+	  latency.push_back( static_cast< std::uint32_t >( std::min< std::int64_t >( took.count( ), UINT32_MAX ) ) );
+	}
+      }, i );
+  }
+  bench_clock::time_point begin = bench_clock::now( );
+  start.store( true, std::memory_order_release );
+  std::this_thread::sleep_for( std::chrono::duration< double >( seconds ) );
+  stop = true;
+  for ( std::thread &worker : workers ) worker.join( );
+  double elapsed = std::chrono::duration< double >( bench_clock::now( ) - begin ).count( );
+  while ( queue.pop( ) );
+
+  std::vector< std::uint32_t > all;
+  for ( std::vector< std::uint32_t > &latency : latencies ) all.insert( all.end( ), latency.begin( ), latency.end( ) );
+  std::sort( all.begin( ), all.end( ) );
+  auto percentile = [ & ]( double p ) { return all.empty( ) ? 0.0 : all[ std::size_t( p * ( all.size( ) - 1 ) ) ] / 1e3; };
+  return run_result{ all.size( ) / elapsed, percentile( 0.5 ), percentile( 0.99 ), percentile( 0.999 ), percentile( 1.0 ) };
+}
+
+static void report( const char *name, std::size_t threads, const run_result &result ) {
+  std::printf( "%-10s %5zu %10.2f %10.2f %10.2f %10.2f %12.2f\n", name, threads, result.ops_per_second / 1e6,
+	       result.p50, result.p99, result.p999, result.max );
+}
+
+int main( int argc, char **argv ) {
+  double seconds = argc > 1 ? std::atof( argv[ 1 ] ) : 1.0;
+  std::size_t prefill = argc > 2 ? std::strtoull( argv[ 2 ], nullptr, 10 ) : 256;
+  std::size_t cores = std::max( 1u, std::thread::hardware_concurrency( ) );
+#if defined LOCKFREE_INJECT_PREEMPTION
+  std::printf( "injecting a stall at 1 in %d preemption points\n", LOCKFREE_INJECT_PREEMPTION );
+#endif
+  std::printf( "%zu cores, %g s per run, %zu items prefilled, latency in us\n", cores, seconds, prefill );
+  std::printf( "%-10s %5s %10s %10s %10s %10s %12s\n", "queue", "thr", "Mops/s", "p50", "p99", "p99.9", "max" );
+  for ( std::size_t factor : { 1, 2, 4, 8 } ) {
+    std::size_t threads = factor * cores;
+    report( "lockfree", threads, run< lockfree::priority_queue< key, key > >( threads, seconds, prefill ) );
+    report( "mutex", threads, run< baseline::locked_priority_queue< key, key > >( threads, seconds, prefill ) );
+    report( "spinlock", threads, run< baseline::locked_priority_queue< key, key, baseline::spinlock > >( threads, seconds, prefill ) );
+  }
+  return 0;
+}
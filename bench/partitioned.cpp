@@ -0,0 +1,56 @@
+// One sorted list against partitioned_priority_queue: threads insert keys spread over a wide range, then pop them all.
+//   g++ -std=c++17 -O2 -pthread -I.. partitioned.cpp -o partitioned && ./partitioned [ items per thread = 20000 ]
+
+#include "partitioned_priority_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint32_t key;
+
+template< class Queue >
+static void run( const char *name, Queue &queue, std::size_t threads, std::size_t items ) {
+  std::vector< std::vector< key > > payloads( threads, std::vector< key >( items ) );
+  std::vector< std::thread > workers;
+  bench_clock::time_point start = bench_clock::now( );
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t id ) {
+	std::mt19937 random( id );
+	for ( key &payload : payloads[ id ] ) queue.insert( &payload, payload = random( ) );
+      }, i );
+  }
+  for ( std::thread &worker : workers ) worker.join( );
+  double insert = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+  workers.clear( );
+  std::atomic< bool > ordered{ true };
+  start = bench_clock::now( );
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ] {
+	key last = ~key( 0 );
+	while ( key *item = queue.pop( ) ) { // each thread's pops must come out in order
+	  if ( *item > last ) ordered = false;
+	  last = *item;
+	}
+      } );
+  }
+  for ( std::thread &worker : workers ) worker.join( );
+  double pop = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+  std::printf( "%-14s %7zu %12.0f %12.0f %8s\n", name, threads, threads * items / insert, threads * items / pop,
+	       ordered ? "ok" : "WRONG" );
+}
+
+int main( int argc, char **argv ) {
+  std::size_t items = argc > 1 ? std::atoi( argv[ 1 ] ) : 20000;
+  std::printf( "%-14s %7s %12s %12s %8s\n", "queue", "threads", "inserts/s", "pops/s", "order" );
+  for ( std::size_t threads : { 1, 2, 4, 8 } ) {
+    lockfree::priority_queue< key, key > single;
+    run( "single list", single, threads, items / threads );
+    lockfree::partitioned_priority_queue< key, key, 64 > partitioned; // uniform keys, so the even split fits
+    run( "64 partitions", partitioned, threads, items / threads );
+  }
+  return 0;
+}
@@ -0,0 +1,176 @@
+// PHOLD on lockfree::event_queue: optimistic ( Time Warp ) execution within a moving window over global virtual time.
+//   g++ -std=c++17 -O2 -pthread -I.. phold.cpp -o phold && ./phold [ processes = 256 ] [ events per process = 4 ] [ end time = 10000 ]
+// Each thread count is checked against a sequential run, then committed events / s and rollbacks are reported.
+
+#include "event_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static std::uint64_t mix( std::uint64_t x ) { // splitmix64
+  x += 0x9e3779b97f4a7c15ull;
+  x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+  x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebull;
+  return x ^ ( x >> 31 );
+}
+
+const std::uint64_t lookahead = 10, mean_delay = 100;
+
+struct event {
+  std::uint64_t time, id;
+  std::uint32_t process;
+  bool sent = false; // its child is out -- the child depends only on the event, so a rerun after rollback need not resend it
+  std::uint64_t state_before; // for rollback
+
+  event( std::uint64_t time, std::uint64_t id, std::uint32_t process ) : time( time ), id( id ), process( process ) { };
+  bool operator<( const event &other ) const { return time < other.time || ( time == other.time && id < other.id ); };
+  event * child( std::uint32_t processes ) const {
+    std::uint64_t random = mix( id );
+    return new event( time + lookahead + random % ( 2 * mean_delay ), random, ( random >> 32 ) % processes );
+  };
+};
+
+struct alignas( 64 ) process {
+  std::mutex lock; // a process runs one event at a time
+  std::uint64_t state = 0; // order sensitive, so any misordering shows up against the sequential run
+  std::vector< event * > history; // processed, in ( timestamp, id ) order -- equal timestamps can roll back too
+};
+
+struct simulation {
+  const std::uint64_t end, window;
+  std::vector< process > processes;
+  lockfree::event_queue< event > queue;
+  std::atomic< std::uint64_t > bound, inserted{ 0 }, rolled_back{ 0 }, rollbacks{ 0 };
+  std::atomic< std::size_t > active{ 0 };
+  std::atomic< bool > done{ false };
+
+  simulation( std::size_t count, std::uint64_t end, std::uint64_t window )
+    : end( end ), window( window ), processes( count ), bound( window ) { };
+
+  void send( event *e ) {
+    inserted.fetch_add( 1 ); // counted first, so a quiet check that sees no change saw no insert
+    queue.schedule( e, e->time );
+  };
+  void execute( event *e ) {
+    process &p = processes[ e->process ];
+    std::lock_guard< std::mutex > guard( p.lock );
+    if ( !p.history.empty( ) && *e < *p.history.back( ) ) { // straggler: undo everything after it
+      std::vector< std::pair< event *, std::uint64_t > > undone;
+      while ( !p.history.empty( ) && *e < *p.history.back( ) ) {
+	event *later = p.history.back( );
+	p.history.pop_back( );
+	p.state = later->state_before;
+	undone.emplace_back( later, later->time );
+      }
+      rollbacks.fetch_add( 1, std::memory_order_relaxed );
+      rolled_back.fetch_add( undone.size( ), std::memory_order_relaxed );
+      inserted.fetch_add( undone.size( ) );
+      queue.rollback_insert( undone.begin( ), undone.end( ) );
+    }
+    e->state_before = p.state;
+    p.state = mix( p.state ^ e->id );
+    p.history.push_back( e );
+    if ( !e->sent ) {
+      e->sent = true;
+      event *next = e->child( processes.size( ) );
+      if ( next->time < end ) send( next );
+      else delete next;
+    }
+  };
+  // pop whatever is inside the window; when every thread comes up empty and nothing was sent meanwhile,
+  // all events up to bound are final, so move the window on
+  void work( ) {
+    while ( !done.load( ) ) {
+      std::uint64_t seen = inserted.load( ), limit = bound.load( );
+      active.fetch_add( 1 );
+      if ( event *e = queue.pop_until( limit ) ) {
+	execute( e );
+	active.fetch_sub( 1 );
+	continue;
+      }
+      if ( active.fetch_sub( 1 ) == 1 && inserted.load( ) == seen ) {
+	if ( limit >= end ) done = true;
+	else bound.compare_exchange_strong( limit, limit + window );
+      } else {
+	std::this_thread::yield( );
+      }
+    }
+  };
+  std::uint64_t checksum( ) const {
+    std::uint64_t sum = 0;
+    for ( const process &p : processes ) sum = mix( sum ^ p.state );
+    return sum;
+  };
+  std::size_t committed( ) const {
+    std::size_t count = 0;
+    for ( const process &p : processes ) count += p.history.size( );
+    return count;
+  };
+  ~simulation( ) {
+    for ( process &p : processes ) for ( event *e : p.history ) delete e;
+  };
+};
+
+static std::vector< event * > initial_events( std::size_t processes, std::size_t per_process ) {
+  std::vector< event * > events;
+  for ( std::size_t i = 0; i < processes * per_process; ++i ) {
+    std::uint64_t random = mix( ~i );
+    events.push_back( new event( random % mean_delay, random, i % processes ) );
+  }
+  return events;
+}
+
+// the same model in timestamp order, for the checksum
+static std::uint64_t sequential( std::size_t processes, std::size_t per_process, std::uint64_t end, std::size_t &events ) {
+  auto later = [ ]( const event *a, const event *b ) { return *b < *a; };
+  std::priority_queue< event *, std::vector< event * >, decltype( later ) > pending( later );
+  std::vector< std::uint64_t > state( processes, 0 );
+  for ( event *e : initial_events( processes, per_process ) ) pending.push( e );
+  events = 0;
+  while ( !pending.empty( ) ) {
+    event *e = pending.top( );
+    pending.pop( );
+    state[ e->process ] = mix( state[ e->process ] ^ e->id );
+    event *next = e->child( processes );
+    if ( next->time < end ) pending.push( next );
+    else delete next;
+    delete e;
+    ++events;
+  }
+  std::uint64_t sum = 0;
+  for ( std::uint64_t s : state ) sum = mix( sum ^ s );
+  return sum;
+}
+
+int main( int argc, char **argv ) {
+  std::size_t processes = argc > 1 ? std::atoi( argv[ 1 ] ) : 256;
+  std::size_t per_process = argc > 2 ? std::atoi( argv[ 2 ] ) : 4;
+  std::uint64_t end = argc > 3 ? std::strtoull( argv[ 3 ], nullptr, 10 ) : 10000;
+  std::size_t events;
+  std::uint64_t expected = sequential( processes, per_process, end, events );
+  std::printf( "%zu processes, %zu events each, end time %llu: %zu events\n", processes, per_process,
+	       static_cast< unsigned long long >( end ), events );
+  std::printf( "%7s %8s %16s %12s %14s %6s\n", "threads", "window", "committed ev/s", "rollbacks", "rolled back", "check" );
+  for ( std::size_t threads : { 1, 2, 4, 8 } ) {
+    for ( std::uint64_t window : { mean_delay, 4 * mean_delay } ) {
+      simulation sim( processes, end, window );
+      for ( event *e : initial_events( processes, per_process ) ) sim.send( e );
+      bench_clock::time_point start = bench_clock::now( );
+      std::vector< std::thread > workers;
+      for ( std::size_t i = 0; i < threads; ++i ) workers.emplace_back( [ & ] { sim.work( ); } );
+      for ( std::thread &worker : workers ) worker.join( );
+      double seconds = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+      std::printf( "%7zu %8llu %16.0f %12llu %14llu %6s\n", threads, static_cast< unsigned long long >( window ),
+		   sim.committed( ) / seconds, static_cast< unsigned long long >( sim.rollbacks.load( ) ),
+		   static_cast< unsigned long long >( sim.rolled_back.load( ) ),
+		   sim.checksum( ) == expected && sim.committed( ) == events ? "ok" : "WRONG" );
+    }
+  }
+  return 0;
+}
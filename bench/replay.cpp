@@ -0,0 +1,75 @@
+// Record a workload trace, or replay one against the lock-free queue and a mutex baseline.
+//   g++ -std=c++17 -O2 -pthread -I.. replay.cpp -o replay
+//   ./replay record trace.bin [ threads = 4 ] [ operations per thread = 100000 ]
+//   ./replay trace.bin [ paced ]
+
+#include "priority_queue.hpp"
+#include "workload_trace.hpp"
+#include "baselines.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+typedef std::uint64_t key;
+
+// a stand-in for production traffic: bursty inserts, mostly pop( ), some bounded pops
+static lockfree::workload_trace< key > record( std::size_t threads, std::size_t operations ) {
+  lockfree::priority_queue< key, key > queue;
+  lockfree::recording_queue< lockfree::priority_queue< key, key > > recorder( queue );
+  std::vector< std::thread > workers;
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t seed ) {
+	std::mt19937_64 random( seed );
+	std::vector< key > payloads( operations );
+	for ( std::size_t op = 0; op < operations; ++op ) {
+	  switch ( random( ) % 8 ) {
+	  case 0: case 1: case 2: case 3: recorder.insert( &payloads[ op ], random( ) % 4096 ); break;
+	  case 7: recorder.pop( 2048 ); break;
+	  default: recorder.pop( ); break;
+	  }
+	  if ( random( ) % 256 == 0 ) std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+	}
+	while ( recorder.pop( ) );
+      }, i );
+  }
+  for ( std::thread &worker : workers ) worker.join( );
+  return recorder.trace( );
+}
+
+static void report( const char *name, const lockfree::replay_result &result ) {
+  std::cout << name << "  " << result.operations / result.seconds / 1e6 << " Mops/s, "
+	    << result.seconds << " s, " << result.empty_pops << " empty pops";
+  if ( result.lag ) std::cout << ", " << result.lag << " ns mean lag";
+  std::cout << "\n";
+}
+
+int main( int argc, char **argv ) {
+  if ( argc > 2 && !std::strcmp( argv[ 1 ], "record" ) ) {
+    lockfree::workload_trace< key > trace = record( argc > 3 ? std::atoi( argv[ 3 ] ) : 4,
+						    argc > 4 ? std::atoi( argv[ 4 ] ) : 100000 );
+    std::ofstream out( argv[ 2 ], std::ios::binary );
+    trace.write_to( out );
+    std::cout << "recorded " << trace.operations( ) << " operations from " << trace.threads.size( ) << " threads\n";
+    return 0;
+  }
+  if ( argc < 2 ) {
+    std::cerr << "usage: replay record trace.bin [ threads ] [ operations ] | replay trace.bin [ paced ]\n";
+    return 1;
+  }
+
+  lockfree::workload_trace< key > trace;
+  std::ifstream in( argv[ 1 ], std::ios::binary );
+  if ( !trace.read_from( in ) ) {
+    std::cerr << argv[ 1 ] << ": not a trace with 64 bit keys\n";
+    return 1;
+  }
+  bool paced = argc > 2 && !std::strcmp( argv[ 2 ], "paced" );
+
+  lockfree::priority_queue< key, key > lockfree_queue;
+  report( "lockfree::priority_queue ", lockfree::replay( trace, lockfree_queue, paced ) );
+  baseline::locked_priority_queue< key, key > mutex_queue;
+  report( "std::priority_queue+mutex", lockfree::replay( trace, mutex_queue, paced ) );
+  return 0;
+}
@@ -0,0 +1,65 @@
+// Many small queues, few busy at a time: a free list per queue against one node pool shared by all of them.
+//   g++ -std=c++17 -O2 -pthread -I.. shared_pool.cpp -o shared_pool && ./shared_pool [ queues = 4096 ] [ burst = 64 ] [ rounds = 4 ]
+// Threads take turns at the queues round-robin, filling one with a burst and draining it, as a connection would.
+
+#include "priority_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint64_t key;
+typedef lockfree::priority_queue< key, key > queue;
+
+static void run( const char *name, std::vector< std::unique_ptr< queue > > &queues, std::size_t threads,
+		 std::size_t burst, std::size_t rounds, bool shared ) {
+  std::vector< std::thread > workers;
+  bench_clock::time_point start = bench_clock::now( );
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t id ) {
+	std::vector< key > payloads( burst );
+	for ( std::size_t round = 0; round < rounds; ++round ) {
+	  for ( std::size_t q = id; q < queues.size( ); q += threads ) {
+	    for ( std::size_t j = 0; j < burst; ++j ) queues[ q ]->insert( &payloads[ j ], j * 7919 % burst );
+	    while ( queues[ q ]->pop( ) );
+	  }
+	}
+      }, i );
+  }
+  for ( std::thread &worker : workers ) worker.join( );
+  double seconds = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+  lockfree::memory_stats first = queues[ 0 ]->memory_usage( );
+  std::size_t nodes = first.pool_bytes / ( first.sentinel_bytes / 2 ), bytes = first.bytes + queues.size( ) * sizeof( queue ); // the queue objects too
+  for ( std::size_t i = 1; i < queues.size( ); ++i ) {
+    lockfree::memory_stats memory = queues[ i ]->memory_usage( );
+    if ( !shared ) nodes += memory.pool_bytes / ( memory.sentinel_bytes / 2 );
+    bytes += shared ? memory.bytes - memory.pool_bytes : memory.bytes; // a shared pool reports the total through every queue
+  }
+  std::printf( "%-12s %7zu %9.2f %12zu %9.0f\n", name, threads, 2.0 * queues.size( ) * burst * rounds / seconds / 1e6,
+	       nodes, bytes / 1024.0 );
+}
+
+int main( int argc, char **argv ) {
+  std::size_t count = argc > 1 ? std::atoi( argv[ 1 ] ) : 4096;
+  std::size_t burst = argc > 2 ? std::atoi( argv[ 2 ] ) : 64;
+  std::size_t rounds = argc > 3 ? std::atoi( argv[ 3 ] ) : 4;
+  std::printf( "%zu queues, bursts of %zu, %zu rounds\n", count, burst, rounds );
+  std::printf( "%-12s %7s %9s %12s %9s\n", "free lists", "threads", "Mops/s", "pool nodes", "KiB" );
+  for ( std::size_t threads : { 1, 4 } ) {
+    {
+      std::vector< std::unique_ptr< queue > > queues;
+      for ( std::size_t i = 0; i < count; ++i ) queues.emplace_back( new queue( ) );
+      run( "per queue", queues, threads, burst, rounds, false );
+    }
+    {
+      queue::pool nodes; // declared first, so it outlives the queues
+      std::vector< std::unique_ptr< queue > > queues;
+      for ( std::size_t i = 0; i < count; ++i ) queues.emplace_back( new queue( nodes ) );
+      run( "shared pool", queues, threads, burst, rounds, true );
+    }
+  }
+  return 0;
+}
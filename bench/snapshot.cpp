@@ -0,0 +1,45 @@
+// Checkpoint / restore throughput: bulk load n items, snapshot them to memory, restore into a second queue.
+//   g++ -std=c++17 -O2 -pthread -I.. snapshot.cpp -o snapshot && ./snapshot [ n = 10000000 ]
+
+#include "priority_queue.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double seconds_since( bench_clock::time_point start ) {
+  return std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+}
+
+int main( int argc, char **argv ) {
+  std::size_t n = argc > 1 ? std::strtoull( argv[ 1 ], nullptr, 10 ) : 10000000;
+  std::vector< std::pair< std::uint64_t *, std::uint64_t > > items;
+  std::mt19937_64 random( 42 );
+  items.reserve( n );
+  for ( std::size_t i = 0; i < n; ++i ) items.emplace_back( new std::uint64_t( i ), random( ) );
+
+  bench_clock::time_point start = bench_clock::now( );
+  lockfree::priority_queue< std::uint64_t, std::uint64_t > source( items.begin( ), items.end( ) );
+  double build = seconds_since( start );
+  items = decltype( items )( );
+
+  std::stringstream stream;
+  start = bench_clock::now( );
+  std::size_t written = source.snapshot_to( stream );
+  double snapshot = seconds_since( start );
+
+  lockfree::priority_queue< std::uint64_t, std::uint64_t > restored;
+  start = bench_clock::now( );
+  bool ok = restored.restore_from( stream );
+  double restore = seconds_since( start );
+
+  std::size_t bytes = stream.str( ).size( );
+  std::cout << "entries     " << written << ( ok ? "" : " ( restore failed )" ) << "\n"
+	    << "bulk build  " << build << " s\n"
+	    << "snapshot    " << snapshot << " s, " << bytes / snapshot / 1e6 << " MB/s, " << bytes << " bytes\n"
+	    << "restore     " << restore << " s, " << written / restore / 1e6 << " M entries/s\n";
+  return ok ? 0 : 1;
+}
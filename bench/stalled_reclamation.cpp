@@ -0,0 +1,96 @@
+// Memory held back by a stalled thread: refcounted priority_queue against ibr_priority_queue under 2GEIBR and plain EBR.
+//   g++ -std=c++17 -O2 -pthread -I.. stalled_reclamation.cpp -o stalled_reclamation && ./stalled_reclamation [ seconds per run = 1 ] [ threads = 4 ] [ prefill = 256 ]
+// With a stall, one more thread opens a reservation ( as if descheduled mid-pop ) and holds it for the whole run.
+
+#include "priority_queue.hpp"
+#include "ibr_priority_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint64_t key;
+
+template< class Queue >
+struct stall { // nothing to hold open in the refcounted queue: a stalled thread there pins a node or two
+  static constexpr bool possible = false;
+  stall( Queue & ) { };
+};
+template< class T, typename K, class Policy >
+struct stall< lockfree::ibr_priority_queue< T, K, Policy > > {
+  static constexpr bool possible = true;
+  typename lockfree::ibr_priority_queue< T, K, Policy >::guard pinned;
+  stall( lockfree::ibr_priority_queue< T, K, Policy > &queue ) : pinned( queue ) { };
+};
+
+template< class T, typename K >
+static std::size_t unreclaimed( lockfree::priority_queue< T, K > &queue, std::size_t items ) {
+  return queue.memory_usage( ).live_nodes - items; // popped but not yet back on the free list
+}
+template< class T, typename K, class Policy >
+static std::size_t unreclaimed( lockfree::ibr_priority_queue< T, K, Policy > &queue, std::size_t ) {
+  return queue.unreclaimed( );
+}
+
+// every thread pops an item and puts it back under a new key until the time is up
+template< class Queue >
+static void run( const char *name, bool stalled, std::size_t threads, double seconds, std::size_t prefill ) {
+  Queue queue;
+  std::vector< key > payloads( prefill );
+  std::mt19937_64 random( 7 );
+  for ( key &payload : payloads ) queue.insert( &payload, random( ) % 1024 );
+
+  std::atomic< bool > start{ false }, stop{ false };
+  std::atomic< std::size_t > operations{ 0 };
+  std::vector< std::thread > workers;
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t id ) {
+	std::mt19937_64 random( id );
+	std::size_t done = 0;
+	while ( !start.load( std::memory_order_acquire ) ) std::this_thread::yield( );
+	while ( !stop.load( std::memory_order_relaxed ) ) {
+	  if ( key *item = queue.pop( ) ) queue.insert( item, random( ) % 1024 );
+	  done += 2;
+	}
+	operations += done;
+      }, i );
+  }
+  if ( stalled ) {
+    workers.emplace_back( [ & ] {
+	stall< Queue > pinned( queue );
+	while ( !stop.load( ) ) std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      } );
+  }
+  std::size_t peak = 0;
+  bench_clock::time_point begin = bench_clock::now( );
+  start.store( true, std::memory_order_release );
+  while ( bench_clock::now( ) - begin < std::chrono::duration< double >( seconds ) ) {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    peak = std::max( peak, unreclaimed( queue, prefill ) );
+  }
+  stop = true;
+  for ( std::thread &worker : workers ) worker.join( );
+  double elapsed = std::chrono::duration< double >( bench_clock::now( ) - begin ).count( );
+  std::size_t end = unreclaimed( queue, prefill );
+  while ( queue.pop( ) );
+  std::printf( "%-14s %6s %9.2f %14zu %14zu\n", name, stalled ? "yes" : "no", operations / elapsed / 1e6, peak, end );
+}
+
+int main( int argc, char **argv ) {
+  double seconds = argc > 1 ? std::atof( argv[ 1 ] ) : 1;
+  std::size_t threads = argc > 2 ? std::atoi( argv[ 2 ] ) : 4;
+  std::size_t prefill = argc > 3 ? std::atoi( argv[ 3 ] ) : 256;
+  std::printf( "%zu threads, prefill %zu, %.1f s per run\n", threads, prefill, seconds );
+  std::printf( "%-14s %6s %9s %14s %14s\n", "reclamation", "stall", "Mops/s", "peak held", "held at end" );
+  typedef lockfree::ibr_priority_queue< key, key, lockfree::interval_reclamation > ibr_queue;
+  typedef lockfree::ibr_priority_queue< key, key, lockfree::epoch_reclamation > ebr_queue;
+  run< lockfree::priority_queue< key, key > >( "refcount", false, threads, seconds, prefill );
+  for ( bool stalled : { false, true } ) {
+    run< ibr_queue >( "2GEIBR", stalled, threads, seconds, prefill );
+    run< ebr_queue >( "EBR", stalled, threads, seconds, prefill );
+  }
+  return 0;
+}
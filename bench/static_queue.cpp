@@ -0,0 +1,53 @@
+// Allocation-free queue: priority_queue against static_priority_queue, each thread popping the best item and inserting it again.
+//   g++ -std=c++17 -O2 -pthread -I.. static_queue.cpp -o static_queue && ./static_queue [ operations per thread = 200000 ]
+// The static queue is a global, so it lives in static storage and is never constructed on the heap.
+
+#include "priority_queue.hpp"
+#include "static_priority_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint32_t key;
+
+static const std::size_t size = 128, max_threads = 8;
+static lockfree::static_priority_queue< key, key, size + max_threads > fixed;
+
+template< class Queue >
+static void run( const char *name, Queue &queue, std::size_t threads, std::size_t operations ) {
+  std::vector< key > payloads( size );
+  std::mt19937 random( 3 );
+  for ( key &payload : payloads ) queue.insert( &payload, payload = random( ) % 1024 );
+
+  std::vector< std::thread > workers;
+  bench_clock::time_point start = bench_clock::now( );
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t id ) {
+	std::mt19937 random( id );
+	for ( std::size_t j = 0; j < operations; ++j ) {
+	  key *item = queue.pop( );
+	  if ( item ) queue.insert( item, *item = random( ) % 1024 );
+	}
+      }, i );
+  }
+  for ( std::thread &worker : workers ) worker.join( );
+  double seconds = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+  while ( queue.pop( ) );
+  std::printf( "%-16s %7zu %10.2f\n", name, threads, 2.0 * threads * operations / seconds / 1e6 );
+}
+
+int main( int argc, char **argv ) {
+  std::size_t operations = argc > 1 ? std::atoi( argv[ 1 ] ) : 200000;
+  std::printf( "%zu items, %zu pops and inserts per thread\n", size, operations );
+  std::printf( "%-16s %7s %10s\n", "queue", "threads", "Mops/s" );
+  for ( std::size_t threads = 1; threads <= max_threads; threads *= 2 ) {
+    lockfree::priority_queue< key, key > heap;
+    run( "priority_queue", heap, threads, operations );
+    run( "static", fixed, threads, operations );
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+// Durable inserts and pops: throughput of durable_priority_queue at several commit intervals, against the in-memory queue and a sync per insert.
+//   g++ -std=c++17 -O2 -pthread -I.. wal.cpp -o wal && ./wal [ log path = wal.log ] [ operations per thread = 100000 ] [ replayed items = 1000000 ]
+// The log is removed afterwards.
+
+#include "durable_priority_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef std::uint32_t key;
+
+struct job {
+  std::uint64_t id, arg;
+};
+
+static const std::size_t size = 256; // queued throughout, so the list walk stays short
+
+// each thread inserts a job and pops the best one, operations times
+template< class Queue, class Then >
+static void run( const char *name, Queue &queue, std::size_t threads, std::size_t operations, Then after_insert ) {
+  for ( std::size_t i = 0; i < size; ++i ) queue.insert( new job{ i, 0 }, i % 64 );
+  std::vector< std::thread > workers;
+  bench_clock::time_point start = bench_clock::now( );
+  for ( std::size_t i = 0; i < threads; ++i ) {
+    workers.emplace_back( [ & ]( std::size_t id ) {
+	std::mt19937 random( id );
+	for ( std::size_t j = 0; j < operations; ++j ) {
+	  queue.insert( new job{ j, id }, random( ) % 64 );
+	  after_insert( );
+	  delete queue.pop( );
+	}
+      }, i );
+  }
+  for ( std::thread &worker : workers ) worker.join( );
+  double seconds = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+  while ( job *item = queue.pop( ) ) delete item;
+  std::printf( "%-16s %7zu %10.3f", name, threads, 2.0 * threads * operations / seconds / 1e6 );
+}
+
+int main( int argc, char **argv ) {
+  std::string path = argc > 1 ? argv[ 1 ] : "wal.log";
+  std::size_t operations = argc > 2 ? std::atoi( argv[ 2 ] ) : 100000;
+  std::size_t replayed = argc > 3 ? std::atoi( argv[ 3 ] ) : 1000000;
+  typedef lockfree::durable_priority_queue< job, key > durable;
+  std::printf( "%zu inserts and pops per thread, log at %s\n", operations, path.c_str( ) );
+  std::printf( "%-16s %7s %10s %10s %12s\n", "commit", "threads", "Mops/s", "commits", "ops/commit" );
+  for ( std::size_t threads : { 1, 4 } ) {
+    {
+      lockfree::priority_queue< job, key > memory;
+      run( "in memory", memory, threads, operations, [ ] { } );
+      std::printf( "\n" );
+    }
+    for ( long us : { 100, 1000, 10000, 100000 } ) {
+      std::remove( path.c_str( ) );
+      std::string name = "every " + std::to_string( us ) + " us";
+      durable queue( path, std::chrono::microseconds( us ) );
+      run( name.c_str( ), queue, threads, operations, [ ] { } );
+      queue.sync( );
+      std::uint64_t commits = queue.commits( );
+      std::printf( " %10llu %12.0f\n", static_cast< unsigned long long >( commits ), 2.0 * threads * operations / commits );
+    }
+    {
+      std::remove( path.c_str( ) );
+      durable queue( path, std::chrono::nanoseconds( 0 ) );
+      run( "sync each insert", queue, threads, operations / 100, [ & ] { queue.sync( ); } ); // slow enough with a hundredth
+      std::uint64_t commits = queue.commits( );
+      std::printf( " %10llu %12.1f\n", static_cast< unsigned long long >( commits ), 2.0 * threads * ( operations / 100 ) / commits );
+    }
+  }
+
+  std::remove( path.c_str( ) );
+  {
+    durable queue( path, std::chrono::milliseconds( 10 ) );
+    for ( std::size_t i = 0; i < replayed; ++i ) queue.insert( new job{ i, 0 }, i ); // each goes in front, so filling is quick
+  } // the destructor commits, and leaves the items in the log
+  bench_clock::time_point start = bench_clock::now( );
+  {
+    durable queue( path );
+    double seconds = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+    std::printf( "replayed %zu items in %.3f s\n", replayed, seconds );
+  }
+  std::remove( path.c_str( ) );
+  return 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "priority_queue.hpp"
+
+#if !defined LOCKFREE_SOJOURN
+#error "codel_queue needs enqueue timestamps: define LOCKFREE_SOJOURN wherever priority_queue.hpp is included"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+/* Active queue management for the priority queue, after CoDel ( Nichols and Jacobson, RFC 8289 ).
+
+   Pops watch how long the items they take have waited, and the queue judges
+   each interval by it: when waits stayed above target for a whole interval
+   there is a standing queue rather than a burst, and the queue sheds work
+   from the low priority end with pop_lowest( ) until an interval comes back
+   under target.
+
+   Two changes from CoDel on a FIFO. Pops take the best items, which jump the
+   backlog and may wait very little while lower priorities pile up behind them,
+   so an interval is judged by its longest wait rather than its shortest. And
+   CoDel's square-root drop schedule expects senders that back off on a drop,
+   which producers of work do not: here every pop that takes an item sheds one
+   more while the standing queue lasts. Shedding then keeps pace with service
+   however long the overload, up to half of what leaves the queue, and never
+   outruns it. Empty pops are not judged.
+
+   Shed items go to the shed callback, which owns them ( the default deletes
+   them ). One pop at a time runs the control law; pops that find it busy skip it.
+
+   Only removals the control law sees are public: pop( ), pop( key ) and
+   pop_measured. consume, pop_if, pushpop, leases and pop_lowest would take
+   items without judging their waits, so they are not offered.
+*/
+
+namespace lockfree {
+
+  template< typename T, typename K >
+  class codel_queue : protected priority_queue< T, K > {
+    typedef _priority_queue< T, K > base;
+
+    const std::uint64_t target, interval; // ns
+    std::function< void( T * ) > shed;
+    std::atomic_flag busy = ATOMIC_FLAG_INIT;
+    std::uint64_t interval_end = 0, longest = 0; // guarded by busy, like the rest of the control state
+    bool standing = false; // the last interval judged stayed above target
+    std::atomic< std::uint64_t > shed_items{ 0 };
+
+    bool drop( ) {
+      T *victim = base::pop_lowest( );
+      if ( !victim ) return false;
+      shed_items.fetch_add( 1, std::memory_order_relaxed );
+      shed( victim );
+      return true;
+    };
+    // run the control law on the wait of an item just taken, unless another pop is running it
+    void judge( std::uint64_t waited ) {
+      if ( busy.test_and_set( std::memory_order_acquire ) ) return;
+      control( waited, base::steady_ns( ) );
+      busy.clear( std::memory_order_release );
+    };
+    void control( std::uint64_t waited, std::uint64_t now ) {
+      longest = std::max( longest, waited );
+      if ( now >= interval_end ) { // judge the interval just gone
+	standing = longest >= target;
+	longest = 0;
+	interval_end = now + interval;
+      }
+      if ( standing ) drop( ); // one item per pop at most
+    };
+  public:
+    using typename base::value_type;
+    using typename base::key_type;
+    using base::insert;
+    using base::insert_bulk;
+    using base::reserve;
+    using base::snapshot_to;
+    using base::memory_usage;
+    using base::sojourn_histogram;
+    using base::reset_sojourn_histogram;
+
+    codel_queue( std::function< void( T * ) > shed = [ ]( T *item ) { delete item; },
+		 std::chrono::nanoseconds target = std::chrono::milliseconds( 5 ),
+		 std::chrono::nanoseconds interval = std::chrono::milliseconds( 100 ) )
+      : priority_queue< T, K >( ), target( target.count( ) ), interval( interval.count( ) ), shed( std::move( shed ) ) { };
+
+    T * pop( ) {
+      std::uint64_t waited;
+      return pop_measured( waited );
+    };
+    T * pop( K key ) {
+      std::uint64_t waited;
+      T *ret = base::pop_measured( key, waited );
+      if ( ret ) judge( waited );
+      return ret;
+    };
+    T * pop_measured( std::uint64_t &waited ) {
+      T *ret = base::pop_measured( waited );
+      if ( ret ) judge( waited );
+      return ret;
+    };
+
+    std::uint64_t shed_count( ) const {
+      return shed_items.load( std::memory_order_relaxed );
+    };
+  };
+
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include "priority_queue.hpp"
+#include "thread_slots.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* A priority queue that survives crashes through a write-ahead log.
+
+   insert and pop append a fixed-size record to a buffer of the calling
+   thread's own and return; a committer thread gathers every buffer each
+   interval and writes them with one pwritev and one fdatasync, so a commit
+   costs the same for one record as for thousands.
+
+   Operations are durable once a commit covering them finishes: sync( )
+   starts one at once and waits for it. A pop is logged after it happens, so
+   after a crash an item may come back that was already handed out --
+   delivery is at least once.
+
+   Opening a log replays it: every insert without its pop is rebuilt with
+   assign( ), in the order the items went in, and the log is rewritten with
+   only those before new records go after them. A record torn by a crash fails
+   its checksum and ends the replay. Interval zero commits only on sync( ).
+
+   T and K are logged as bytes, so both must be trivially copyable.
+*/
+
+namespace lockfree {
+
+  template< class T, typename K >
+  class durable_priority_queue {
+    static_assert( std::is_trivially_copyable< T >::value && std::is_trivially_copyable< K >::value, "items are logged as bytes" );
+    static_assert( std::is_default_constructible< T >::value, "replay makes each item before copying its bytes in" );
+
+    struct entry {
+      std::uint64_t id; // logged with the insert, so the pop can name it
+      T *value;
+    };
+
+    static constexpr std::uint64_t pop_flag = std::uint64_t( 1 ) << 63;
+    static constexpr std::size_t record_size = sizeof( std::uint64_t ) + sizeof( K ) + sizeof( T ) + sizeof( std::uint32_t );
+    static constexpr std::size_t max_threads = 256;
+
+    struct thread_log {
+      std::atomic_flag busy = ATOMIC_FLAG_INIT; // its thread appending or the committer taking the records
+      std::vector< char > records;
+    };
+
+    priority_queue< entry, K > queue;
+    thread_slots< thread_log, max_threads > threads;
+    std::atomic< std::uint64_t > next_id{ 0 };
+    const std::chrono::nanoseconds interval;
+    int fd = -1;
+    off_t end = 0; // of the log, written by the committer only
+
+    std::mutex mutex; // guards the rest
+    std::condition_variable wake, committed;
+    std::uint64_t started = 0, finished = 0; // commits
+    bool stop = false, hurry = false;
+    int error = 0; // errno of the first failed commit
+    std::thread committer;
+
+    // FNV-1a over the record, so a zeroed tail does not pass either
+    static std::uint32_t checksum( const char *record ) {
+      std::uint32_t hash = 2166136261u;
+      for ( std::size_t i = 0; i < record_size - sizeof( std::uint32_t ); ++i ) {
+	hash = ( hash ^ static_cast< unsigned char >( record[ i ] ) ) * 16777619u;
+      }
+      return hash;
+    };
+    // a pop has no key or value, and logs zeroes
+    static void encode( char *record, std::uint64_t id, const K *key, const T *value ) {
+      std::memset( record, 0, record_size );
+      std::memcpy( record, &id, sizeof( id ) );
+      if ( key ) std::memcpy( record + sizeof( id ), key, sizeof( K ) );
+      if ( value ) std::memcpy( record + sizeof( id ) + sizeof( K ), value, sizeof( T ) );
+      std::uint32_t check = checksum( record );
+      std::memcpy( record + record_size - sizeof( check ), &check, sizeof( check ) );
+    };
+
+    void append( std::uint64_t id, const K *key = nullptr, const T *value = nullptr ) {
+      char record[ record_size ];
+      encode( record, id, key, value );
+      thread_log &log = threads.local( );
+      while ( log.busy.test_and_set( std::memory_order_acquire ) ) std::this_thread::yield( ); // only while the committer swaps
+      log.records.insert( log.records.end( ), record, record + record_size );
+      log.busy.clear( std::memory_order_release );
+    };
+
+    // write pieces at the end of the log and make them durable, returning an errno on failure
+    int write_out( iovec *pieces, int count, std::size_t bytes ) {
+      ssize_t written;
+      auto advance = [ & ]( std::size_t done ) { // past what was written, which may end mid-piece
+	end += done;
+	bytes -= done;
+	while ( count && done >= pieces->iov_len ) {
+	  done -= pieces->iov_len;
+	  ++pieces;
+	  --count;
+	}
+	if ( count ) {
+	  pieces->iov_base = static_cast< char * >( pieces->iov_base ) + done;
+	  pieces->iov_len -= done;
+	}
+      };
+      while ( bytes ) {
+	written = pwritev( fd, pieces, count, end );
+	if ( written < 0 ) {
+	  if ( errno == EINTR ) continue;
+	  return errno;
+	}
+	advance( written );
+      }
+      return fdatasync( fd ) ? errno : 0;
+    };
+    // swap out every thread's records and commit them, returning an errno on failure
+    int commit( std::vector< std::vector< char > > &spares ) {
+      iovec pieces[ max_threads ];
+      int count = 0;
+      std::size_t bytes = 0, used = threads.used( );
+      for ( std::size_t i = 0; i < used; ++i ) {
+	thread_log &log = threads[ i ];
+	spares[ i ].clear( ); // written last time, and its capacity goes back to the thread
+	while ( log.busy.test_and_set( std::memory_order_acquire ) ) std::this_thread::yield( );
+	log.records.swap( spares[ i ] );
+	log.busy.clear( std::memory_order_release );
+	if ( spares[ i ].empty( ) ) continue;
+	pieces[ count++ ] = { spares[ i ].data( ), spares[ i ].size( ) };
+	bytes += spares[ i ].size( );
+      }
+      return count ? write_out( pieces, count, bytes ) : 0;
+    };
+    void commit_loop( ) {
+      std::vector< std::vector< char > > spares( max_threads );
+      std::unique_lock< std::mutex > lock( mutex );
+      while ( true ) {
+	auto due = [ this ] { return hurry || stop; };
+	if ( interval.count( ) ) wake.wait_for( lock, interval, due );
+	else wake.wait( lock, due );
+	bool last = stop;
+	std::uint64_t number = ++started; // counted before any swap, so sync( ) can tell which commits cover it
+	hurry = false;
+	lock.unlock( );
+	int failed = commit( spares );
+	lock.lock( );
+	finished = number;
+	if ( failed && !error ) error = failed;
+	committed.notify_all( );
+	if ( last ) return;
+      }
+    };
+
+    static void fail( const std::string &what ) {
+      throw std::system_error( errno, std::generic_category( ), what );
+    };
+    // rebuild the queue from the log at path, then leave only the live records in it
+    void replay( const std::string &path ) {
+      std::vector< char > data;
+      int in = ::open( path.c_str( ), O_RDONLY );
+      if ( in < 0 && errno != ENOENT ) fail( "open " + path );
+      if ( in >= 0 ) {
+	char chunk[ 1 << 16 ];
+	ssize_t got;
+	while ( ( got = ::read( in, chunk, sizeof( chunk ) ) ) != 0 ) {
+	  if ( got < 0 && errno == EINTR ) continue;
+	  if ( got < 0 ) {
+	    ::close( in );
+	    fail( "read " + path );
+	  }
+	  data.insert( data.end( ), chunk, chunk + got );
+	}
+	::close( in );
+      }
+
+      std::unordered_map< std::uint64_t, const char * > live;
+      std::unordered_set< std::uint64_t > popped; // a pop can be logged before its insert, from another thread's buffer
+      std::uint64_t id, ids = 0;
+      std::uint32_t check;
+      for ( std::size_t at = 0; at + record_size <= data.size( ); at += record_size ) {
+	const char *record = data.data( ) + at;
+	std::memcpy( &check, record + record_size - sizeof( check ), sizeof( check ) );
+	if ( check != checksum( record ) ) break; // torn by a crash mid-commit
+	std::memcpy( &id, record, sizeof( id ) );
+	ids = std::max( ids, ( id & ~pop_flag ) + 1 );
+	if ( id & pop_flag ) {
+	  if ( !live.erase( id & ~pop_flag ) ) popped.insert( id & ~pop_flag );
+	} else if ( !popped.erase( id ) ) {
+	  live.emplace( id, record );
+	}
+      }
+      next_id = ids;
+
+      std::vector< std::pair< std::uint64_t, const char * > > kept( live.begin( ), live.end( ) );
+      std::sort( kept.begin( ), kept.end( ) ); // insertion order, which assign keeps among equal keys
+      std::vector< std::pair< entry *, K > > items;
+      std::vector< char > compacted;
+      items.reserve( kept.size( ) );
+      compacted.reserve( kept.size( ) * record_size );
+      for ( auto &record : kept ) {
+	K key;
+	T *value = new T;
+	std::memcpy( &key, record.second + sizeof( id ), sizeof( K ) );
+	std::memcpy( value, record.second + sizeof( id ) + sizeof( K ), sizeof( T ) );
+	items.emplace_back( new entry{ record.first, value }, key );
+	compacted.insert( compacted.end( ), record.second, record.second + record_size );
+      }
+      queue.assign( items.begin( ), items.end( ) );
+
+      // new records go after the live ones, never after a torn tail
+      std::string fresh = path + ".compact", directory = path.substr( 0, path.find_last_of( '/' ) + 1 );
+      fd = ::open( fresh.c_str( ), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+      if ( fd < 0 ) fail( "open " + fresh );
+      iovec all = { compacted.data( ), compacted.size( ) };
+      errno = write_out( &all, 1, compacted.size( ) );
+      if ( errno ) fail( "write " + fresh );
+      if ( ::rename( fresh.c_str( ), path.c_str( ) ) ) fail( "rename " + fresh );
+      int parent = ::open( directory.empty( ) ? "." : directory.c_str( ), O_RDONLY );
+      if ( parent < 0 || ::fsync( parent ) ) fail( "sync directory of " + path );
+      ::close( parent );
+    };
+  public:
+    typedef T value_type;
+    typedef K key_type;
+
+    // open or create the log at path, committing every interval
+    explicit durable_priority_queue( const std::string &path, std::chrono::nanoseconds interval = std::chrono::milliseconds( 1 ) )
+      : interval( interval ) {
+      try {
+	replay( path );
+      } catch ( ... ) {
+	if ( fd >= 0 ) ::close( fd );
+	throw;
+      }
+      committer = std::thread( [ this ] { commit_loop( ); } );
+    };
+    durable_priority_queue( durable_priority_queue & ) = delete;
+    // commits what is left; items still queued stay in the log for the next open
+    ~durable_priority_queue( ) {
+      {
+	std::lock_guard< std::mutex > lock( mutex );
+	stop = true;
+      }
+      wake.notify_one( );
+      committer.join( );
+      entry *item;
+      while ( ( item = queue.pop( ) ) ) {
+	delete item->value;
+	delete item;
+      }
+      ::close( fd );
+    };
+
+    // takes ownership of value, which is logged by copy
+    void insert( T *value, K key ) {
+      std::uint64_t id = next_id.fetch_add( 1, std::memory_order_relaxed );
+      append( id, &key, value );
+      queue.insert( new entry{ id, value }, key ); // logged first, so the pop is always logged after it
+    };
+    T * pop( ) {
+      entry *item = queue.pop( );
+      if ( !item ) return nullptr;
+      T *value = item->value;
+      append( item->id | pop_flag );
+      delete item;
+      return value;
+    };
+
+    // wait until everything logged before the call is on disk
+    void sync( ) {
+      std::unique_lock< std::mutex > lock( mutex );
+      std::uint64_t target = started + 1; // one in progress may have swapped this thread's records already
+      hurry = true;
+      wake.notify_one( );
+      committed.wait( lock, [ & ] { return finished >= target || error; } );
+      if ( error ) throw std::system_error( error, std::generic_category( ), "commit" );
+    };
+    std::uint64_t commits( ) {
+      std::lock_guard< std::mutex > lock( mutex );
+      return finished;
+    };
+  };
+
+}
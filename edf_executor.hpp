@@ -0,0 +1,154 @@
+#pragma once
+
+#include "event_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* An earliest-deadline-first executor.
+
+   submit( task, deadline ) queues a task from any thread, tasks included, and
+   the worker threads run them earliest deadline first out of an event_queue
+   keyed by deadline. A worker that finds nothing to do yields for a while and
+   then parks on a condition variable; submit only takes the lock when a
+   worker is parked, so a busy executor never does.
+
+   Each task is timed against its deadline as it finishes: statistics( )
+   reports how many ran, how many finished late, by how much in total and at
+   worst, and how often workers parked. With LOCKFREE_USDT every miss also
+   fires deadline_miss( executor, ns late ).
+
+   Late tasks still run. The destructor runs what is queued, then joins the
+   workers. A task that throws ends the program, as it would on a std::thread.
+*/
+
+namespace lockfree {
+
+  struct edf_stats {
+    std::uint64_t completed, missed, parks;
+    std::chrono::nanoseconds total_lateness, worst_lateness;
+  };
+
+  class edf_executor {
+  public:
+    typedef std::chrono::steady_clock clock;
+  private:
+    struct task {
+      std::function< void( ) > run;
+      std::uint64_t deadline; // ns since the clock's epoch
+    };
+
+    static constexpr std::size_t counter_shards = 16, spins = 64; // yields before parking
+    struct alignas( 64 ) counter { // one cache line per shard of workers
+      std::atomic< std::uint64_t > completed{ 0 }, missed{ 0 }, parks{ 0 }, late{ 0 }, worst{ 0 };
+    };
+
+    event_queue< task > queue;
+    counter counters[ counter_shards ];
+    std::atomic< std::size_t > parked{ 0 };
+    std::atomic< bool > stopping{ false };
+    std::mutex mutex; // only for parking
+    std::condition_variable unpark;
+    std::vector< std::thread > workers;
+
+    static std::uint64_t ns( clock::time_point time ) {
+      return std::max< clock::rep >( 0, std::chrono::duration_cast< std::chrono::nanoseconds >( time.time_since_epoch( ) ).count( ) );
+    };
+    counter & local_counter( ) {
+      return counters[ shard_index( ) % counter_shards ];
+    };
+
+    void finish( task *next ) {
+      std::unique_ptr< task > done( next );
+      done->run( );
+      std::uint64_t now = ns( clock::now( ) ), late, worst;
+      counter &stats = local_counter( );
+      stats.completed.fetch_add( 1, std::memory_order_relaxed );
+      if ( now <= done->deadline ) return;
+      late = now - done->deadline;
+      stats.missed.fetch_add( 1, std::memory_order_relaxed );
+      stats.late.fetch_add( late, std::memory_order_relaxed );
+      worst = stats.worst.load( std::memory_order_relaxed );
+      while ( late > worst && !stats.worst.compare_exchange_weak( worst, late, std::memory_order_relaxed ) );
+      LOCKFREE_PROBE2( deadline_miss, this, late );
+    };
+    // sleep until there is a task or the executor stops -- nullptr means it stopped
+    task * park( ) {
+      std::unique_lock< std::mutex > lock( mutex );
+      task *next;
+      parked.fetch_add( 1 ); // before looking again, against submit looking at parked after its insert
+      while ( !( next = queue.pop( ) ) && !stopping.load( ) ) {
+	local_counter( ).parks.fetch_add( 1, std::memory_order_relaxed );
+	unpark.wait( lock );
+      }
+      parked.fetch_sub( 1 );
+      return next;
+    };
+    void work( ) {
+      task *next;
+      std::size_t idle = 0;
+      while ( true ) {
+	if ( ( next = queue.pop( ) ) ) {
+	  idle = 0;
+	} else if ( stopping.load( ) ) {
+	  return; // and the queue is drained
+	} else if ( ++idle < spins ) {
+	  std::this_thread::yield( );
+	  continue;
+	} else if ( !( next = park( ) ) ) {
+	  return;
+	}
+	finish( next );
+      }
+    };
+  public:
+    explicit edf_executor( std::size_t threads = std::max( 1u, std::thread::hardware_concurrency( ) ) ) {
+      for ( std::size_t i = 0; i < threads; ++i ) workers.emplace_back( [ this ] { work( ); } );
+    };
+    edf_executor( edf_executor & ) = delete;
+    ~edf_executor( ) {
+      {
+	std::lock_guard< std::mutex > lock( mutex );
+	stopping = true;
+      }
+      unpark.notify_all( );
+      for ( std::thread &worker : workers ) worker.join( );
+    };
+
+    void submit( std::function< void( ) > run, clock::time_point deadline ) {
+      std::uint64_t due = ns( deadline );
+      queue.schedule( new task{ std::move( run ), due }, due );
+      if ( parked.load( ) ) {
+	std::lock_guard< std::mutex > lock( mutex );
+	unpark.notify_one( );
+      }
+    };
+    void submit( std::function< void( ) > run, clock::duration within ) {
+      submit( std::move( run ), clock::now( ) + within );
+    };
+
+    edf_stats statistics( ) const {
+      edf_stats sum = { 0, 0, 0, std::chrono::nanoseconds( 0 ), std::chrono::nanoseconds( 0 ) };
+      for ( const counter &stats : counters ) {
+	sum.completed += stats.completed.load( std::memory_order_relaxed );
+	sum.missed += stats.missed.load( std::memory_order_relaxed );
+	sum.parks += stats.parks.load( std::memory_order_relaxed );
+	sum.total_lateness += std::chrono::nanoseconds( stats.late.load( std::memory_order_relaxed ) );
+	sum.worst_lateness = std::max( sum.worst_lateness, std::chrono::nanoseconds( stats.worst.load( std::memory_order_relaxed ) ) );
+      }
+      return sum;
+    };
+    std::size_t worker_count( ) const {
+      return workers.size( );
+    };
+  };
+
+}
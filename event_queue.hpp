@@ -0,0 +1,58 @@
+#pragma once
+
+#include "priority_queue.hpp"
+#include "key_encoding.hpp"
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/* A pending event list for parallel discrete-event simulation.
+
+   Events come out earliest timestamp first: the key is the complement of the
+   order-preserving encoding of Time, so any Time with a key_encoding works.
+   pop_until( bound ) only hands out events at or before bound, which is how an
+   optimistic simulator keeps workers within a window of global virtual time,
+   and rollback_insert puts back a batch of undone events with a single walk.
+
+   T carries its own timestamp -- the queue only orders by it.
+*/
+
+namespace lockfree {
+
+  template< class T, typename Time = std::uint64_t >
+  class event_queue {
+  public:
+    typedef typename key_encoding< Time >::type key_type;
+  private:
+    priority_queue< T, key_type > queue;
+
+    static key_type key_for( Time time ) {
+      return static_cast< key_type >( ~encode_key( time ) ); // earliest is best
+    };
+  public:
+    typedef T value_type;
+    typedef Time time_type;
+
+    void schedule( T *event, Time time ) {
+      queue.insert( event, key_for( time ) );
+    };
+    // the earliest event, if it is no later than bound
+    T * pop_until( Time bound ) {
+      return queue.pop( key_for( bound ) );
+    };
+    // the earliest event
+    T * pop( ) {
+      return queue.pop( );
+    };
+    // reschedule ( T *, Time ) pairs undone by a rollback
+    template< class InputIt >
+    void rollback_insert( InputIt first, InputIt last ) {
+      std::vector< std::pair< T *, key_type > > items;
+      items.reserve( std::distance( first, last ) );
+      for ( ; first != last; ++first ) items.emplace_back( first->first, key_for( first->second ) );
+      queue.insert_bulk( items.begin( ), items.end( ) );
+    };
+  };
+
+}
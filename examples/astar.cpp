@@ -0,0 +1,152 @@
+// Parallel A* on a random 4-connected grid, strict vs relaxed open list, single vs bulk child inserts.
+//   g++ -std=c++17 -O2 -pthread -I.. astar.cpp -o astar && ./astar [ side = 512 ] [ obstacle percent = 30 ]
+// Reports wall time and expansions against sequential A* -- relaxed order trades re-expansions for less contention.
+
+#include "frontier.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+
+const std::uint32_t unreached = UINT32_MAX;
+
+struct grid {
+  std::uint32_t side;
+  std::vector< char > blocked;
+
+  grid( std::uint32_t side, unsigned percent ) : side( side ), blocked( side * side ) {
+    std::mt19937 random( 1 );
+    for ( char &cell : blocked ) cell = random( ) % 100 < percent;
+    blocked.front( ) = blocked.back( ) = 0;
+  };
+  std::uint32_t goal( ) const { return side * side - 1; };
+  std::uint32_t h( std::uint32_t cell ) const { return 2 * ( side - 1 ) - cell % side - cell / side; }; // manhattan
+  template< class F >
+  void neighbours( std::uint32_t cell, F &&f ) const {
+    std::uint32_t x = cell % side, y = cell / side;
+    if ( x > 0 && !blocked[ cell - 1 ] ) f( cell - 1 );
+    if ( x + 1 < side && !blocked[ cell + 1 ] ) f( cell + 1 );
+    if ( y > 0 && !blocked[ cell - side ] ) f( cell - side );
+    if ( y + 1 < side && !blocked[ cell + side ] ) f( cell + side );
+  };
+  // lower f first, then deeper
+  std::uint64_t key( std::uint32_t cell, std::uint32_t g ) const {
+    return static_cast< std::uint64_t >( UINT32_MAX - ( g + h( cell ) ) ) << 32 | g;
+  };
+};
+
+struct open_node {
+  std::uint32_t cell, g;
+};
+
+struct result {
+  std::uint32_t cost;
+  std::size_t expansions;
+  double seconds;
+};
+
+static result sequential( const grid &map ) {
+  std::priority_queue< std::pair< std::uint64_t, std::uint32_t > > open;
+  std::vector< std::uint32_t > best( map.blocked.size( ), unreached );
+  result r{ unreached, 0, 0 };
+  bench_clock::time_point start = bench_clock::now( );
+  best[ 0 ] = 0;
+  open.emplace( map.key( 0, 0 ), 0 );
+  while ( !open.empty( ) ) {
+    std::uint32_t cell = open.top( ).second, g = static_cast< std::uint32_t >( open.top( ).first );
+    open.pop( );
+    if ( g != best[ cell ] ) continue;
+    ++r.expansions;
+    if ( cell == map.goal( ) ) {
+      r.cost = g;
+      break;
+    }
+    map.neighbours( cell, [ & ]( std::uint32_t next ) {
+	if ( g + 1 < best[ next ] ) {
+	  best[ next ] = g + 1;
+	  open.emplace( map.key( next, g + 1 ), next );
+	}
+      } );
+  }
+  r.seconds = std::chrono::duration< double >( bench_clock::now( ) - start ).count( );
+  return r;
+}
+
+static result parallel( const grid &map, std::size_t threads, std::size_t queues, bool bulk ) {
+  frontier< open_node, std::uint64_t > open( queues, bulk );
+  std::vector< std::atomic< std::uint32_t > > best( map.blocked.size( ) );
+  std::atomic< std::uint32_t > incumbent{ unreached };
+  std::atomic< std::size_t > expansions{ 0 };
+  for ( std::atomic< std::uint32_t > &g : best ) g.store( unreached, std::memory_order_relaxed );
+  bench_clock::time_point start = bench_clock::now( );
+  best[ 0 ] = 0;
+  std::pair< open_node *, std::uint64_t > root( new open_node{ 0, 0 }, map.key( 0, 0 ) );
+  open.push( &root, &root + 1 );
+
+  auto work = [ & ] {
+    std::vector< std::pair< open_node *, std::uint64_t > > children;
+    while ( !open.finished( ) ) {
+      open_node *node = open.pop( );
+      if ( !node ) {
+	std::this_thread::yield( ); // others are still expanding
+	continue;
+      }
+      std::uint32_t g = node->g;
+      // skip nodes reached more cheaply since, or that cannot beat the best path found
+      if ( g == best[ node->cell ].load( ) && g + map.h( node->cell ) < incumbent.load( ) ) {
+	expansions.fetch_add( 1, std::memory_order_relaxed );
+	if ( node->cell == map.goal( ) ) {
+	  std::uint32_t cost = incumbent.load( );
+	  while ( g < cost && !incumbent.compare_exchange_weak( cost, g ) );
+	} else {
+	  map.neighbours( node->cell, [ & ]( std::uint32_t next ) {
+	      std::uint32_t known = best[ next ].load( );
+	      while ( g + 1 < known ) {
+		if ( best[ next ].compare_exchange_weak( known, g + 1 ) ) {
+		  children.emplace_back( new open_node{ next, g + 1 }, map.key( next, g + 1 ) );
+		  break;
+		}
+	      }
+	    } );
+	  open.push( children.begin( ), children.end( ) );
+	  children.clear( );
+	}
+      }
+      delete node;
+      open.done( );
+    }
+  };
+  std::vector< std::thread > workers;
+  for ( std::size_t i = 0; i < threads; ++i ) workers.emplace_back( work );
+  for ( std::thread &worker : workers ) worker.join( );
+  return result{ incumbent.load( ), expansions.load( ),
+      std::chrono::duration< double >( bench_clock::now( ) - start ).count( ) };
+}
+
+int main( int argc, char **argv ) {
+  std::uint32_t side = argc > 1 ? std::atoi( argv[ 1 ] ) : 512;
+  unsigned percent = argc > 2 ? std::atoi( argv[ 2 ] ) : 30;
+  grid map( side, percent );
+  result reference = sequential( map );
+  if ( reference.cost == unreached ) {
+    std::printf( "no path on this grid, try fewer obstacles\n" );
+    return 1;
+  }
+  std::printf( "%ux%u grid, %u%% blocked, path cost %u\n", side, side, percent, reference.cost );
+  std::printf( "%-16s %7s %10s %11s %6s\n", "open list", "threads", "seconds", "expansions", "cost" );
+  std::printf( "%-16s %7d %10.4f %11zu %6s\n", "std::priority_q", 1, reference.seconds, reference.expansions, "ok" );
+  for ( std::size_t threads : { 1, 2, 4, 8 } ) {
+    struct { const char *name; std::size_t queues; bool bulk; } modes[ ] = {
+      { "strict", 1, false }, { "strict bulk", 1, true }, { "relaxed bulk", 2 * threads, true } };
+    for ( auto &mode : modes ) {
+      result r = parallel( map, threads, mode.queues, mode.bulk );
+      std::printf( "%-16s %7zu %10.4f %11zu %6s\n", mode.name, threads, r.seconds, r.expansions,
+		   r.cost == reference.cost ? "ok" : "WRONG" );
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "priority_queue.hpp"
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <vector>
+
+/* Open list for the parallel best-first search examples.
+
+   With one queue pop( ) is strictly best first. With several, pushes go to a
+   random queue and pops take the better front of two random queues -- a relaxed
+   order that spreads contention at the cost of some wasted expansions.
+   Bulk pushes go through insert_bulk, one walk for all of a node's children.
+
+   pending counts items pushed but not yet finished, so workers stop when it
+   reaches zero rather than on the first empty pop.
+*/
+
+template< class T, typename K >
+class frontier {
+  std::vector< std::unique_ptr< lockfree::priority_queue< T, K > > > queues;
+  std::atomic< std::size_t > pending{ 0 };
+  const bool bulk;
+
+  lockfree::priority_queue< T, K > & pick( ) {
+    thread_local std::minstd_rand random( std::random_device{ }( ) );
+    return *queues[ random( ) % queues.size( ) ];
+  };
+public:
+  frontier( std::size_t count, bool bulk ) : bulk( bulk ) {
+    for ( std::size_t i = 0; i < count; ++i ) queues.emplace_back( new lockfree::priority_queue< T, K >( ) );
+  };
+  ~frontier( ) {
+    while ( T *item = pop( ) ) delete item;
+  };
+
+  // a range of ( T *, K ) pairs
+  template< class InputIt >
+  void push( InputIt first, InputIt last ) {
+    lockfree::priority_queue< T, K > &queue = pick( );
+    pending.fetch_add( std::distance( first, last ) );
+    if ( bulk ) {
+      queue.insert_bulk( first, last );
+    } else {
+      for ( ; first != last; ++first ) queue.insert( first->first, first->second );
+    }
+  };
+  T * pop( ) {
+    T *item;
+    if ( queues.size( ) == 1 ) return queues[ 0 ]->pop( );
+    if ( ( item = lockfree::pop_best_of( pick( ), pick( ) ) ) ) return item;
+    for ( auto &queue : queues ) { // the two picked were empty, so look everywhere before giving up
+      if ( ( item = queue->pop( ) ) ) return item;
+    }
+    return nullptr;
+  };
+  // call once per popped item, after pushing its children
+  void done( ) {
+    pending.fetch_sub( 1 );
+  };
+  bool finished( ) const {
+    return pending.load( ) == 0;
+  };
+};
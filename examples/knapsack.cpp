@@ -0,0 +1,132 @@
+// Parallel best-first branch and bound for 0/1 knapsack, strict vs relaxed open list, single vs bulk child inserts.
+//   g++ -std=c++17 -O2 -pthread -I.. knapsack.cpp -o knapsack && ./knapsack [ items = 70 ] [ seed = 1 ]
+// Nodes are ordered on their fractional ( Dantzig ) bound, a double, through key_encoding; the answer is checked by DP.
+
+#include "frontier.hpp"
+#include "key_encoding.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+typedef lockfree::key_encoding< double >::type bound_key;
+
+struct instance {
+  std::vector< std::uint32_t > weight, value; // sorted by value density, best first
+  std::uint32_t capacity;
+
+  instance( std::size_t n, unsigned seed ) {
+    std::mt19937 random( seed );
+    std::vector< std::pair< std::uint32_t, std::uint32_t > > items;
+    std::uint64_t total = 0;
+    for ( std::size_t i = 0; i < n; ++i ) { // strongly correlated, which keeps the bound loose
+      std::uint32_t w = 10 + random( ) % 91;
+      items.emplace_back( w, w + 10 );
+      total += w;
+    }
+    std::sort( items.begin( ), items.end( ), [ ]( const auto &a, const auto &b ) {
+	return std::uint64_t( a.second ) * b.first > std::uint64_t( b.second ) * a.first;
+      } );
+    for ( auto &item : items ) {
+      weight.push_back( item.first );
+      value.push_back( item.second );
+    }
+    capacity = total / 2;
+  };
+  // fill greedily from item level on, then a fraction of the first item that does not fit
+  double bound( std::size_t level, std::uint32_t w, std::uint32_t v ) const {
+    double b = v;
+    for ( ; level < weight.size( ) && w + weight[ level ] <= capacity; ++level ) {
+      w += weight[ level ];
+      b += value[ level ];
+    }
+    if ( level < weight.size( ) ) b += double( capacity - w ) * value[ level ] / weight[ level ];
+    return b;
+  };
+  std::uint32_t dynamic_programming( ) const {
+    std::vector< std::uint32_t > best( capacity + 1, 0 );
+    for ( std::size_t i = 0; i < weight.size( ); ++i ) {
+      for ( std::uint32_t c = capacity; c >= weight[ i ]; --c ) best[ c ] = std::max( best[ c ], best[ c - weight[ i ] ] + value[ i ] );
+    }
+    return best[ capacity ];
+  };
+};
+
+struct bb_node {
+  std::uint32_t level, weight, value;
+  double bound;
+};
+
+struct result {
+  std::uint32_t value;
+  std::size_t expansions;
+  double seconds;
+};
+
+static result solve( const instance &problem, std::size_t threads, std::size_t queues, bool bulk ) {
+  frontier< bb_node, bound_key > open( queues, bulk );
+  std::atomic< std::uint32_t > incumbent{ 0 };
+  std::atomic< std::size_t > expansions{ 0 };
+  bench_clock::time_point start = bench_clock::now( );
+  double root_bound = problem.bound( 0, 0, 0 );
+  std::pair< bb_node *, bound_key > root( new bb_node{ 0, 0, 0, root_bound }, lockfree::encode_key( root_bound ) );
+  open.push( &root, &root + 1 );
+
+  auto work = [ & ] {
+    std::vector< std::pair< bb_node *, bound_key > > children;
+    auto improve = [ & ]( std::uint32_t value ) {
+      std::uint32_t best = incumbent.load( );
+      while ( value > best && !incumbent.compare_exchange_weak( best, value ) );
+    };
+    auto branch = [ & ]( std::uint32_t level, std::uint32_t weight, std::uint32_t value ) {
+      improve( value ); // every node is a feasible packing
+      double b = problem.bound( level, weight, value );
+      if ( level < problem.weight.size( ) && b > incumbent.load( ) + 0.5 ) // values are integral
+	children.emplace_back( new bb_node{ level, weight, value, b }, lockfree::encode_key( b ) );
+    };
+    while ( !open.finished( ) ) {
+      bb_node *node = open.pop( );
+      if ( !node ) {
+	std::this_thread::yield( ); // others are still expanding
+	continue;
+      }
+      if ( node->bound > incumbent.load( ) + 0.5 ) { // otherwise pruned since it was pushed
+	expansions.fetch_add( 1, std::memory_order_relaxed );
+	std::uint32_t w = problem.weight[ node->level ], v = problem.value[ node->level ];
+	if ( node->weight + w <= problem.capacity ) branch( node->level + 1, node->weight + w, node->value + v );
+	branch( node->level + 1, node->weight, node->value );
+	open.push( children.begin( ), children.end( ) );
+	children.clear( );
+      }
+      delete node;
+      open.done( );
+    }
+  };
+  std::vector< std::thread > workers;
+  for ( std::size_t i = 0; i < threads; ++i ) workers.emplace_back( work );
+  for ( std::thread &worker : workers ) worker.join( );
+  return result{ incumbent.load( ), expansions.load( ),
+      std::chrono::duration< double >( bench_clock::now( ) - start ).count( ) };
+}
+
+int main( int argc, char **argv ) {
+  std::size_t n = argc > 1 ? std::atoi( argv[ 1 ] ) : 70;
+  unsigned seed = argc > 2 ? std::atoi( argv[ 2 ] ) : 1;
+  instance problem( n, seed );
+  std::uint32_t optimum = problem.dynamic_programming( );
+  std::printf( "%zu items, capacity %u, optimum %u\n", n, problem.capacity, optimum );
+  std::printf( "%-16s %7s %10s %11s %6s\n", "open list", "threads", "seconds", "expansions", "value" );
+  for ( std::size_t threads : { 1, 2, 4, 8 } ) {
+    struct { const char *name; std::size_t queues; bool bulk; } modes[ ] = {
+      { "strict", 1, false }, { "strict bulk", 1, true }, { "relaxed bulk", 2 * threads, true } };
+    for ( auto &mode : modes ) {
+      result r = solve( problem, threads, mode.queues, mode.bulk );
+      std::printf( "%-16s %7zu %10.4f %11zu %6s\n", mode.name, threads, r.seconds, r.expansions,
+		   r.value == optimum ? "ok" : "WRONG" );
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "thread_slots.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/* The sorted-list priority queue without reference counts.
+
+   Nodes are unlinked Harris / Michael style ( mark the next link, then swing
+   the predecessor ) and freed through interval-based reclamation ( 2GEIBR,
+   Wen et al. ): every node records the epochs it was born and retired in, and
+   every operation reserves the interval of epochs it may have read nodes from.
+   A retired node is freed once no reservation overlaps its lifetime. Reads
+   cost a load of the global epoch instead of two read-modify-writes per hop,
+   and a thread stalled mid-operation only pins the nodes that were alive while
+   it ran -- everything born after its reservation is still freed.
+
+   epoch_reclamation swaps in plain EBR ( a stalled reservation pins everything
+   retired after it ) with the same layout, for comparison.
+
+   Each thread takes a slot per queue on first use and gives it back when it
+   exits; up to max_threads threads can use a queue at once.
+*/
+
+namespace lockfree {
+
+  struct interval_reclamation { static constexpr bool intervals = true; };
+  struct epoch_reclamation { static constexpr bool intervals = false; };
+
+  template< class T, typename K, class Policy = interval_reclamation >
+  class ibr_priority_queue {
+    struct Node {
+      K key;
+      T *value;
+      std::atomic< Node * > next; // marked once popped
+      std::uint64_t birth, retire; // epochs
+      Node( K key, T *value, std::uint64_t birth ) : key( key ), value( value ), next( nullptr ), birth( birth ), retire( 0 ) { };
+    };
+
+    static constexpr std::uint64_t inactive = ~std::uint64_t( 0 );
+    static constexpr std::size_t max_threads = 256, epoch_every = 64, scan_every = 64;
+
+    struct thread_slot {
+      std::atomic< std::uint64_t > lower{ inactive }, upper{ inactive }; // reserved epochs while in an operation
+      std::size_t depth = 0, allocated = 0;
+      std::vector< Node * > retired; // left to the next thread taking the slot
+    };
+
+    std::atomic< Node * > head{ nullptr };
+    std::atomic< std::uint64_t > epoch{ 1 };
+    std::atomic< long > unreclaimed_nodes{ 0 };
+    thread_slots< thread_slot, max_threads > threads;
+
+    template< class U >
+    static inline U * get_marked( U *i ) {
+      return reinterpret_cast< U * >( reinterpret_cast< uintptr_t >( i ) | 1 );
+    };
+    template< class U >
+    static inline U * get_unmarked( U *i ) {
+      return reinterpret_cast< U * >( reinterpret_cast< uintptr_t >( i ) & ~uintptr_t( 1 ) );
+    };
+    template< class U >
+    static inline bool is_marked( U *i ) {
+      return reinterpret_cast< uintptr_t >( i ) & 1;
+    };
+
+    // read a link, first widening the reservation to the current epoch so the node read is covered
+    Node * protect( std::atomic< Node * > &link, thread_slot &slot ) {
+      Node *read;
+      std::uint64_t now;
+      if ( !Policy::intervals ) return link.load( );
+      while ( true ) {
+	read = link.load( );
+	now = epoch.load( );
+	if ( slot.upper.load( std::memory_order_relaxed ) == now ) return read;
+	slot.upper = now;
+      }
+    };
+    Node * allocate( K key, T *value, thread_slot &slot ) {
+      if ( ++slot.allocated % epoch_every == 0 ) epoch.fetch_add( 1 );
+      return new Node( key, value, epoch.load( ) );
+    };
+    void retire( Node *node, thread_slot &slot ) {
+      node->retire = epoch.load( );
+      slot.retired.push_back( node );
+      unreclaimed_nodes.fetch_add( 1, std::memory_order_relaxed );
+      if ( slot.retired.size( ) % scan_every == 0 ) scan( slot );
+    };
+    // free the retired nodes no reservation overlaps
+    void scan( thread_slot &slot ) {
+      std::vector< std::pair< std::uint64_t, std::uint64_t > > reserved;
+      std::size_t used = threads.used( ), freed = 0;
+      for ( std::size_t i = 0; i < used; ++i ) {
+	std::uint64_t lower = threads[ i ].lower.load( ), upper = threads[ i ].upper.load( );
+	if ( lower != inactive ) reserved.emplace_back( lower, upper );
+      }
+      auto pinned = [ & ]( Node *node ) {
+	for ( const auto &reservation : reserved ) {
+	  if ( node->retire >= reservation.first && ( !Policy::intervals || node->birth <= reservation.second ) ) return true;
+	}
+	return false;
+      };
+      auto keep = std::partition( slot.retired.begin( ), slot.retired.end( ), pinned );
+      for ( auto node = keep; node != slot.retired.end( ); ++node, ++freed ) delete *node;
+      slot.retired.erase( keep, slot.retired.end( ) );
+      unreclaimed_nodes.fetch_sub( freed, std::memory_order_relaxed );
+    };
+
+    // Michael's search: the link to swing for key and the first node worse than it, unlinking popped nodes on the way
+    std::atomic< Node * > * find( const K &key, Node *&curr, thread_slot &slot ) {
+      std::atomic< Node * > *prev;
+      Node *next, *expected;
+      bool restart;
+      do {
+	restart = false;
+	prev = &head;
+	curr = protect( *prev, slot );
+	while ( curr ) {
+	  next = protect( curr->next, slot );
+	  if ( is_marked( next ) ) { // popped, so unlink it on the popper's behalf
+	    expected = curr;
+	    if ( !prev->compare_exchange_strong( expected, get_unmarked( next ) ) ) {
+	      restart = true; // prev changed under us
+	      break;
+	    }
+	    retire( curr, slot );
+	    curr = get_unmarked( next );
+	    continue;
+	  }
+	  if ( key > curr->key ) break; // equal keys stay in insertion order
+	  prev = &curr->next;
+	  curr = next;
+	}
+      } while ( restart );
+      return prev;
+    };
+    // pop the first node, if bound says its key will do
+    template< class Bound >
+    T * pop_first( Bound &&bound ) {
+      guard pinned( *this );
+      Node *first, *next, *expected;
+      while ( ( first = protect( head, pinned.slot ) ) ) {
+	next = protect( first->next, pinned.slot );
+	if ( is_marked( next ) ) { // popped but still linked
+	  expected = first;
+	  if ( head.compare_exchange_strong( expected, get_unmarked( next ) ) ) retire( first, pinned.slot );
+	  continue;
+	}
+	if ( !bound( first->key ) ) return nullptr;
+	if ( first->next.compare_exchange_strong( next, get_marked( next ) ) ) { // it's ours
+	  T *value = first->value;
+	  expected = first;
+	  if ( head.compare_exchange_strong( expected, next ) ) retire( first, pinned.slot ); // or whoever unlinks it does
+	  return value;
+	}
+      }
+      return nullptr;
+    };
+  public:
+    typedef T value_type;
+    typedef K key_type;
+
+    // a reservation held for the length of an operation -- holding one on purpose is how a stalled thread looks
+    class guard {
+      friend class ibr_priority_queue;
+      thread_slot &slot;
+    public:
+      guard( ibr_priority_queue &queue ) : slot( queue.threads.local( ) ) {
+	if ( slot.depth++ ) return;
+	std::uint64_t now = queue.epoch.load( );
+	slot.upper = now; // lower last: scan skips slots whose lower is inactive
+	slot.lower = now;
+      };
+      guard( const guard & ) = delete;
+      ~guard( ) {
+	if ( --slot.depth ) return;
+	slot.lower = inactive;
+	slot.upper = inactive;
+      };
+    };
+
+    ibr_priority_queue( ) = default;
+    ibr_priority_queue( ibr_priority_queue & ) = delete;
+    ~ibr_priority_queue( ) { // no operations left, so everything can go
+      Node *node = head.load( ), *next;
+      while ( node ) {
+	next = node->next.load( );
+	if ( !is_marked( next ) ) delete node->value; // popped values belong to whoever popped them
+	delete node;
+	node = get_unmarked( next );
+      }
+      for ( std::size_t i = 0; i < threads.used( ); ++i ) {
+	for ( Node *retired : threads[ i ].retired ) delete retired;
+	threads[ i ].retired.clear( );
+      }
+    };
+
+    void insert( T *value, K key ) {
+      guard pinned( *this );
+      Node *node = allocate( key, value, pinned.slot ), *curr;
+      std::atomic< Node * > *prev;
+      do {
+	prev = find( key, curr, pinned.slot );
+	node->next.store( curr, std::memory_order_relaxed );
+      } while ( !prev->compare_exchange_strong( curr, node ) );
+    };
+    T * pop( ) {
+      return pop_first( [ ]( const K & ) { return true; } );
+    };
+    T * pop( K key ) {
+      return pop_first( [ & ]( const K &first ) { return !( key > first ); } );
+    };
+
+    // retired nodes not yet freed -- bounded under 2GEIBR even with a stalled thread
+    std::size_t unreclaimed( ) const {
+      return std::max( unreclaimed_nodes.load( std::memory_order_relaxed ), 0L );
+    };
+    std::uint64_t current_epoch( ) const {
+      return epoch.load( );
+    };
+  };
+
+}
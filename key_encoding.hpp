@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/* Order-preserving key encodings.
+
+   key_encoding< K > maps a key onto an unsigned integer such that
+     a > b  <=>  encode( a ) > encode( b )
+   so a backend can swap K's operator> for a plain integer compare.
+
+   unsigned integers pass through, signed integers flip the sign bit,
+   IEEE floats flip the sign bit ( and every bit of negatives ) and
+   pairs / tuples concatenate their members, first member most significant.
+
+   NaNs have no place in the order, and -0.0 encodes just below +0.0.
+*/
+
+namespace lockfree {
+
+  // smallest unsigned integer holding Bits bits
+  template< std::size_t Bits, typename = void >
+  struct uint_for_bits;
+  template< std::size_t Bits >
+  struct uint_for_bits< Bits, typename std::enable_if< ( Bits <= 8 ) >::type > { typedef std::uint8_t type; };
+  template< std::size_t Bits >
+  struct uint_for_bits< Bits, typename std::enable_if< ( Bits > 8 && Bits <= 16 ) >::type > { typedef std::uint16_t type; };
+  template< std::size_t Bits >
+  struct uint_for_bits< Bits, typename std::enable_if< ( Bits > 16 && Bits <= 32 ) >::type > { typedef std::uint32_t type; };
+  template< std::size_t Bits >
+  struct uint_for_bits< Bits, typename std::enable_if< ( Bits > 32 && Bits <= 64 ) >::type > { typedef std::uint64_t type; };
+
+  template< typename K, typename = void >
+  struct key_encoding; // left undefined: K has no order-preserving encoding
+
+  template< typename K >
+  struct key_encoding< K, typename std::enable_if< std::is_integral< K >::value && std::is_unsigned< K >::value >::type > {
+    static constexpr std::size_t bits = std::numeric_limits< K >::digits;
+    typedef typename uint_for_bits< bits >::type type;
+
+    static constexpr type encode( K key ) { return static_cast< type >( key ); }
+    static constexpr K decode( type code ) { return static_cast< K >( code ); }
+  };
+
+  template< typename K >
+  struct key_encoding< K, typename std::enable_if< std::is_integral< K >::value && std::is_signed< K >::value >::type > {
+    static constexpr std::size_t bits = std::numeric_limits< K >::digits + 1;
+    typedef typename std::make_unsigned< K >::type type;
+    static constexpr type sign = type( 1 ) << ( bits - 1 );
+
+    static constexpr type encode( K key ) { return static_cast< type >( key ) ^ sign; }
+    static constexpr K decode( type code ) { return static_cast< K >( code ^ sign ); }
+  };
+
+  template< typename K >
+  struct key_encoding< K, typename std::enable_if< std::is_floating_point< K >::value &&
+						   std::numeric_limits< K >::is_iec559 &&
+						   ( sizeof( K ) == 4 || sizeof( K ) == 8 ) >::type > {
+    static constexpr std::size_t bits = sizeof( K ) * 8;
+    typedef typename uint_for_bits< bits >::type type;
+    static constexpr type sign = type( 1 ) << ( bits - 1 );
+
+    static type encode( K key ) {
+      type code;
+      std::memcpy( &code, &key, sizeof( code ) );
+      return ( code & sign ) ? ~code : code | sign; // negatives count down, positives sit above them
+    };
+    static K decode( type code ) {
+      K key;
+      code = ( code & sign ) ? code & ~sign : ~code;
+      std::memcpy( &key, &code, sizeof( key ) );
+      return key;
+    };
+  };
+
+  template< typename A, typename B >
+  struct key_encoding< std::pair< A, B > > {
+    typedef key_encoding< A > first_encoding;
+    typedef key_encoding< B > second_encoding;
+    static constexpr std::size_t bits = first_encoding::bits + second_encoding::bits;
+    static_assert( bits <= 64, "pair keys must fit in 64 bits" );
+    typedef typename uint_for_bits< bits >::type type;
+
+    static type encode( const std::pair< A, B > &key ) {
+      return static_cast< type >( static_cast< type >( first_encoding::encode( key.first ) ) << second_encoding::bits |
+				  second_encoding::encode( key.second ) );
+    };
+    static std::pair< A, B > decode( type code ) {
+      return std::pair< A, B >( first_encoding::decode( code >> second_encoding::bits ),
+				second_encoding::decode( code & ( ( type( 1 ) << second_encoding::bits ) - 1 ) ) );
+    };
+  };
+
+  template< typename... Ks >
+  struct key_encoding< std::tuple< Ks... > > {
+    static constexpr std::size_t bits = ( 0 + ... + key_encoding< Ks >::bits );
+    static_assert( bits <= 64, "tuple keys must fit in 64 bits" );
+    typedef typename uint_for_bits< bits >::type type;
+
+    static type encode( const std::tuple< Ks... > &key ) {
+      return encode( key, std::index_sequence_for< Ks... >( ) );
+    };
+    static std::tuple< Ks... > decode( type code ) {
+      return decode( code, std::index_sequence_for< Ks... >( ) );
+    };
+  private:
+    // bits taken by the members following member I
+    template< std::size_t I >
+    static constexpr std::size_t shift( ) {
+      std::size_t sizes[ ] = { key_encoding< Ks >::bits... }, total = 0;
+      for ( std::size_t i = I + 1; i < sizeof...( Ks ); ++i ) total += sizes[ i ];
+      return total;
+    };
+    template< std::size_t... I >
+    static type encode( const std::tuple< Ks... > &key, std::index_sequence< I... > ) {
+      return ( type( 0 ) | ... | static_cast< type >( static_cast< type >( key_encoding< Ks >::encode( std::get< I >( key ) ) ) << shift< I >( ) ) );
+    };
+    template< std::size_t... I >
+    static std::tuple< Ks... > decode( type code, std::index_sequence< I... > ) {
+      return std::tuple< Ks... >( key_encoding< Ks >::decode(
+	static_cast< typename key_encoding< Ks >::type >( ( code >> shift< I >( ) ) &
+							  ( ~std::uint64_t( 0 ) >> ( 64 - key_encoding< Ks >::bits ) ) ) )... );
+    };
+  };
+
+  // true when K can be turned into an order-preserving unsigned integer
+  template< typename K, typename = void >
+  struct has_key_encoding : std::false_type { };
+  template< typename K >
+  struct has_key_encoding< K, decltype( void( key_encoding< K >::encode( std::declval< const K & >( ) ) ) ) > : std::true_type { };
+
+  template< typename K >
+  inline typename key_encoding< K >::type encode_key( const K &key ) {
+    return key_encoding< K >::encode( key );
+  };
+  template< typename K >
+  inline K decode_key( typename key_encoding< K >::type code ) {
+    return key_encoding< K >::decode( code );
+  };
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "priority_queue.hpp"
+#include "key_encoding.hpp"
+
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* k-way merge of sorted streams, smallest key first.
+
+   Each input stream sits in the queue once, keyed on its head value, so a pop
+   hands that stream to one consumer alone: it takes the head, refills from the
+   reader a batch at a time when the buffer runs dry, and puts the stream back
+   keyed on its next value. Several consumers can pop at once; each gets the
+   smallest head there was, but a stream being refilled is out of the queue
+   meanwhile, so the interleaving across consumers is only nearly sorted.
+
+   A Reader has a value_type and std::size_t read( value_type *out, std::size_t max ),
+   returning 0 once it is exhausted. KeyOf maps a value to a key with a key_encoding.
+*/
+
+namespace lockfree {
+
+  // a Reader over an iterator range
+  template< class Iterator >
+  class iterator_reader {
+    Iterator first, last;
+  public:
+    typedef typename std::iterator_traits< Iterator >::value_type value_type;
+
+    iterator_reader( Iterator first, Iterator last ) : first( first ), last( last ) { };
+    std::size_t read( value_type *out, std::size_t max ) {
+      std::size_t count = 0;
+      for ( ; count < max && first != last; ++first, ++count ) out[ count ] = *first;
+      return count;
+    };
+  };
+
+  template< class Iterator >
+  inline iterator_reader< Iterator > make_iterator_reader( Iterator first, Iterator last ) {
+    return iterator_reader< Iterator >( first, last );
+  };
+
+  template< class Reader, class KeyOf >
+  class merge_streams {
+  public:
+    typedef typename Reader::value_type value_type;
+    typedef typename std::decay< decltype( std::declval< KeyOf & >( )( std::declval< const value_type & >( ) ) ) >::type key_type;
+  private:
+    typedef typename key_encoding< key_type >::type encoded_key;
+
+    struct stream { // owned by whoever popped it
+      Reader reader;
+      std::vector< value_type > buffer;
+      std::size_t position = 0, size = 0;
+
+      stream( Reader &&reader, std::size_t batch ) : reader( std::move( reader ) ), buffer( batch ) { };
+      bool refill( ) {
+	position = 0;
+	size = reader.read( buffer.data( ), buffer.size( ) );
+	return size;
+      };
+    };
+
+    std::vector< std::unique_ptr< stream > > streams;
+    priority_queue< stream, encoded_key > heads;
+    std::atomic< std::size_t > active; // streams not yet drained, in the queue or held
+    KeyOf key_of;
+
+    encoded_key key_for( const value_type &value ) {
+      return static_cast< encoded_key >( ~encode_key( key_of( value ) ) ); // smallest is best
+    };
+  public:
+    merge_streams( std::vector< Reader > readers, std::size_t batch = 256, KeyOf key_of = KeyOf( ) )
+      : active( 0 ), key_of( key_of ) {
+      std::vector< std::pair< stream *, encoded_key > > first;
+      for ( Reader &reader : readers ) {
+	streams.emplace_back( new stream( std::move( reader ), batch ) );
+	if ( streams.back( )->refill( ) ) first.emplace_back( streams.back( ).get( ), key_for( streams.back( )->buffer[ 0 ] ) );
+      }
+      active = first.size( );
+      heads.insert_bulk( first.begin( ), first.end( ) );
+    };
+    merge_streams( merge_streams & ) = delete;
+    ~merge_streams( ) {
+      while ( heads.pop( ) ); // streams are owned by streams, not the queue
+    };
+
+    // the next merged value, or false once every stream is drained -- safe from several consumers
+    bool pop( value_type &out ) {
+      stream *s;
+      while ( !( s = heads.pop( ) ) ) {
+	if ( !active.load( ) ) return false;
+	std::this_thread::yield( ); // the rest are held by other consumers
+      }
+      out = std::move( s->buffer[ s->position++ ] );
+      if ( s->position < s->size || s->refill( ) ) heads.insert( s, key_for( s->buffer[ s->position ] ) );
+      else active.fetch_sub( 1 );
+      return true;
+    };
+    std::size_t active_streams( ) const {
+      return active.load( );
+    };
+  };
+
+}
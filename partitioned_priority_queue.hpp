@@ -0,0 +1,194 @@
+#pragma once
+
+#include "priority_queue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* A strict priority queue split into P sub-lists over disjoint key ranges.
+
+   An insert only walks the sub-list for its key, so inserts with distant keys
+   no longer pass through the same prefix nodes. Partitions are ordered like
+   the keys, and a 64-bit occupancy mask has bit i set while partition i may
+   hold items: pop( ) goes straight to the highest set bit, pop_lowest( ) to the
+   lowest, so the global order stays strict.
+
+   Boundaries are quantiles of a key sample. Inserts keep a small reservoir of
+   keys, and repartition( ) recomputes the boundaries from it and moves the
+   items over -- like assign, it is not safe against concurrent access.
+*/
+
+namespace lockfree {
+
+  template< class T, typename K, std::size_t P = 16 >
+  class partitioned_priority_queue {
+    static_assert( P >= 1 && P <= 64, "the occupancy mask has 64 bits" );
+    static_assert( std::is_trivially_copyable< K >::value, "sampled keys are kept in atomics" );
+
+    static constexpr std::size_t sample_size = 1024, sample_every = 16;
+
+    priority_queue< T, K > partitions[ P ];
+    std::array< K, P - 1 > boundaries; // partition i holds [ boundaries[ i - 1 ], boundaries[ i ] )
+    std::atomic< std::uint64_t > occupied{ 0 };
+    std::atomic< long > counts[ P ]; // may dip below zero while a pop overtakes the insert's increment
+    std::array< std::atomic< K >, sample_size > sample;
+    std::atomic< std::size_t > sampled{ 0 };
+
+    static std::size_t highest( std::uint64_t mask ) {
+#if defined __GNUC__
+      return 63 - __builtin_clzll( mask );
+#else
+      std::size_t i = 63;
+      while ( !( mask >> i ) ) --i;
+      return i;
+#endif
+    };
+    static std::size_t lowest( std::uint64_t mask ) {
+#if defined __GNUC__
+      return __builtin_ctzll( mask );
+#else
+      std::size_t i = 0;
+      while ( !( mask >> i & 1 ) ) ++i;
+      return i;
+#endif
+    };
+
+    std::size_t partition_of( const K &key ) const {
+      return std::upper_bound( boundaries.begin( ), boundaries.end( ), key,
+			       [ ]( const K &a, const K &b ) { return b > a; } ) - boundaries.begin( );
+    };
+    // quantiles of a sorted sample
+    void set_boundaries( std::vector< K > &keys ) {
+      std::sort( keys.begin( ), keys.end( ), [ ]( const K &a, const K &b ) { return b > a; } );
+      for ( std::size_t i = 1; i < P; ++i ) boundaries[ i - 1 ] = keys[ i * keys.size( ) / P ];
+    };
+    void sample_key( const K &key ) {
+      thread_local std::uint32_t state = 2463534242u + 97 * shard_index( );
+      state ^= state << 13; // xorshift32
+      state ^= state >> 17;
+      state ^= state << 5;
+      if ( state % sample_every ) return;
+      std::size_t n = sampled.fetch_add( 1, std::memory_order_relaxed );
+      sample[ n < sample_size ? n : ( state / sample_every ) % sample_size ].store( key, std::memory_order_relaxed ); // fill, then replace at random
+    };
+    // a pop found partition i empty or took its last item: clear its bit unless an insert got in first
+    void retire( std::size_t i ) {
+      occupied.fetch_and( ~( std::uint64_t( 1 ) << i ) );
+      if ( counts[ i ].load( ) > 0 ) occupied.fetch_or( std::uint64_t( 1 ) << i );
+    };
+    void taken( std::size_t i ) {
+      if ( counts[ i ].fetch_sub( 1 ) == 1 ) retire( i );
+    };
+  public:
+    typedef T value_type;
+    typedef K key_type;
+
+    // boundaries from a sample of the keys to expect
+    template< class InputIt >
+    partitioned_priority_queue( InputIt first, InputIt last ) {
+      std::vector< K > keys( first, last );
+      for ( std::atomic< long > &count : counts ) count = 0;
+      if ( keys.empty( ) ) keys.push_back( K( ) ); // one split point until repartition( ) has something to go on
+      set_boundaries( keys );
+    };
+    // arithmetic keys without a sample: evenly spaced over the whole range until repartition( )
+    partitioned_priority_queue( ) {
+      static_assert( std::is_arithmetic< K >::value, "other keys need a sample to place the boundaries" );
+      for ( std::atomic< long > &count : counts ) count = 0;
+      long double low = std::numeric_limits< K >::lowest( ), high = std::numeric_limits< K >::max( );
+      for ( std::size_t i = 1; i < P; ++i ) { // interpolated, as high - low overflows for floating-point keys
+	long double f = static_cast< long double >( i ) / P;
+	boundaries[ i - 1 ] = static_cast< K >( low * ( 1 - f ) + high * f );
+      }
+    };
+    partitioned_priority_queue( partitioned_priority_queue & ) = delete;
+
+    void insert( T *value, K key ) {
+      std::size_t i = partition_of( key );
+      sample_key( key );
+      partitions[ i ].insert( value, key );
+      if ( counts[ i ].fetch_add( 1 ) == 0 ) occupied.fetch_or( std::uint64_t( 1 ) << i );
+    };
+    T * pop( ) {
+      std::uint64_t mask;
+      T *ret;
+      while ( ( mask = occupied.load( ) ) ) {
+	std::size_t i = highest( mask );
+	if ( ( ret = partitions[ i ].pop( ) ) ) {
+	  taken( i );
+	  return ret;
+	}
+	if ( counts[ i ].load( ) <= 0 ) retire( i ); // otherwise an insert is landing, so look again
+      }
+      return nullptr;
+    };
+    // the best item if its key is at least key
+    T * pop( K key ) {
+      std::uint64_t mask;
+      std::size_t floor = partition_of( key );
+      T *ret;
+      while ( ( mask = occupied.load( ) ) ) {
+	std::size_t i = highest( mask );
+	if ( i < floor ) return nullptr; // everything left is below key's partition
+	if ( ( ret = i > floor ? partitions[ i ].pop( ) : partitions[ i ].pop( key ) ) ) {
+	  taken( i );
+	  return ret;
+	}
+	if ( i == floor ) return nullptr; // best key in key's own partition is too low, or it emptied
+	if ( counts[ i ].load( ) <= 0 ) retire( i );
+      }
+      return nullptr;
+    };
+    T * pop_lowest( ) {
+      std::uint64_t mask;
+      T *ret;
+      while ( ( mask = occupied.load( ) ) ) {
+	std::size_t i = lowest( mask );
+	if ( ( ret = partitions[ i ].pop_lowest( ) ) ) {
+	  taken( i );
+	  return ret;
+	}
+	if ( counts[ i ].load( ) <= 0 ) retire( i );
+      }
+      return nullptr;
+    };
+
+    // racy but cheap
+    std::size_t size( ) const {
+      long total = 0;
+      for ( const std::atomic< long > &count : counts ) total += count.load( std::memory_order_relaxed );
+      return std::max( total, 0L );
+    };
+    std::uint64_t occupancy( ) const {
+      return occupied.load( );
+    };
+
+    // move the boundaries to the quantiles of the keys sampled so far and redistribute the items
+    // not safe against concurrent access
+    void repartition( ) {
+      std::vector< K > keys;
+      for ( std::size_t i = 0; i < std::min( sampled.load( ), sample_size ); ++i ) keys.push_back( sample[ i ].load( ) );
+      if ( keys.empty( ) ) return;
+      std::vector< std::pair< T *, K > > items;
+      for ( std::size_t i = P; i-- > 0; ) { // best partition first, so items comes out best first
+	while ( partitions[ i ].consume( [ & ]( T *value, const K &key ) { items.emplace_back( value, key ); } ) );
+      }
+      set_boundaries( keys );
+      std::vector< std::pair< T *, K > > split[ P ]; // and so does each split, which assign links in O( n )
+      for ( const std::pair< T *, K > &item : items ) split[ partition_of( item.second ) ].push_back( item );
+      occupied = 0;
+      for ( std::size_t i = 0; i < P; ++i ) {
+	partitions[ i ].assign( split[ i ].begin( ), split[ i ].end( ) );
+	counts[ i ] = split[ i ].size( );
+	if ( !split[ i ].empty( ) ) occupied |= std::uint64_t( 1 ) << i;
+      }
+    };
+  };
+
+}
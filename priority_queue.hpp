@@ -4,30 +4,208 @@
 #include <atomic>
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined LOCKFREE_PARALLEL_SORT // needs the parallel STL backend ( -ltbb with libstdc++ )
+#include <execution>
+#endif
+
+#if defined LOCKFREE_USDT // static tracepoints on the slow paths, see scripts/*.bt
+#include <sys/sdt.h>
+#define LOCKFREE_PROBE1( name, a ) DTRACE_PROBE1( lockfree, name, a )
+#define LOCKFREE_PROBE2( name, a, b ) DTRACE_PROBE2( lockfree, name, a, b )
+#else
+#define LOCKFREE_PROBE1( name, a ) do { } while ( 0 )
+#define LOCKFREE_PROBE2( name, a, b ) do { } while ( 0 )
+#endif
+
+#if defined LOCKFREE_INJECT_PREEMPTION // debug builds: stall 1 in LOCKFREE_INJECT_PREEMPTION passes mid-operation
+#include <chrono>
+#include <thread>
+#include <sched.h>
+#define LOCKFREE_PREEMPTION_POINT( ) lockfree::preemption_point( )
+#else
+#define LOCKFREE_PREEMPTION_POINT( ) do { } while ( 0 )
+#endif
 
 /* An implementation of a lock-free priority queue.
    Follows Michael and Scott memory management method.
 
    T is the Type pointer to hold
    K is the key type ( must allow > comparison )
+
+   Define LOCKFREE_PARALLEL_SORT to sort bulk loads with std::execution::par.
+   Define LOCKFREE_INJECT_PREEMPTION=N to sched_yield or sleep at 1 in N of the points between
+   reading the list and the CAS that acts on it, to see how operations cope with preempted peers.
+   Define LOCKFREE_SOJOURN to timestamp nodes as they are linked and keep a histogram of how long
+   popped items waited ( sojourn_histogram ), which codel_queue.hpp builds on.
+   Define LOCKFREE_USDT to compile in USDT probes ( provider "lockfree" ):
+     help_delete( queue, node ), help_delete_walk( queue, node ), node_alloc( queue, bytes ),
+     insert_retry( queue, retries ), pop_retry( queue, retries ),
+     and deadline_miss( executor, ns late ) from edf_executor.hpp
 */
 
 namespace lockfree {
 
+  // small per-thread index for spreading counters and lists over shards
+  inline std::size_t shard_index( ) {
+    static std::atomic< std::size_t > next( 0 );
+    thread_local std::size_t index = next++;
+    return index;
+  };
+
+#if defined LOCKFREE_INJECT_PREEMPTION
+  inline void preemption_point( ) {
+    thread_local std::uint32_t state = 2463534242u + 97 * shard_index( );
+    state ^= state << 13; // xorshift32
+    state ^= state >> 17;
+    state ^= state << 5;
+    if ( state % ( LOCKFREE_INJECT_PREEMPTION ) ) return;
+    if ( state & 0x100 ) sched_yield( );
+    else std::this_thread::sleep_for( std::chrono::microseconds( 50 ) ); // as if descheduled
+  };
+#endif
+
+  struct memory_stats {
+    std::size_t live_nodes; // handed out by get_new_node and not yet reclaimed, popped or not -- on a pool, by every queue
+    std::size_t free_nodes; // waiting on the free list
+    std::size_t peak_live_nodes; // sampled whenever the pool runs dry and on each memory_usage call
+    std::size_t pool_bytes; // every node allocated so far, and a shared pool's counters -- only freed with the queue, or its pool
+    std::size_t sentinel_bytes; // head and tail
+    std::size_t counter_bytes; // the queue's own sharded counters
+    std::size_t bytes; // all of the above, also the peak as nothing is returned early
+  };
+
   template< class T, typename K, typename = void >
   class _priority_queue {
   protected:
     struct Node { // pointer cleanup is managed by queue
       K key;
-      std::atomic< int > counter; // reference count
+      std::atomic< int > counter; // reference count in steps of one_ref, plus claimed_bit
       std::atomic< T * > value; // data ptr
       std::atomic< Node * > next;
-      Node( ) : counter( 1 ), next( nullptr ) { };
-      Node( K key, T *value ) : key( key ), value( value ), counter( 1 ), next( nullptr ) { }
+      std::atomic< Node * > prev; // predecessor hint -- holds no reference
+      std::atomic< std::uint64_t > lease; // deadline while leased out by lease_pop, else 0
+      std::atomic< T * > stash; // the payload while value is held
+      std::atomic< const _priority_queue * > owner; // the queue that last took it, so hints into another queue on a pool are refused
+#if defined LOCKFREE_SOJOURN
+      std::uint64_t enqueued = 0; // steady_ns( ) when linked
+#endif
+      Node( ) : counter( one_ref ), next( nullptr ), prev( nullptr ), lease( 0 ), stash( nullptr ), owner( nullptr ) { };
+      Node( K key, T *value ) : key( key ), counter( one_ref ), value( value ), next( nullptr ), prev( nullptr ), lease( 0 ), stash( nullptr ), owner( nullptr ) { }
+    };
+    // claimed is set while a node is on the free list or not yet published -- it shares the word
+    // with the count so dropping the last reference and claiming the node is one step
+    static constexpr int claimed_bit = 1, one_ref = 2;
+    static bool is_claimed( Node *node ) {
+      return node->counter.load( ) & claimed_bit;
     };
+    static void push_free( std::atomic< Node * > &list, Node *node ) {
+      Node *free_ptr;
+      do {
+	free_ptr = list;
+	node->next = free_ptr; // add it to the front of the list
+      } while ( !list.compare_exchange_weak( free_ptr, node ) );
+    };
+
+    static constexpr std::size_t counter_shards = 16;
+    struct alignas( 64 ) node_counter { // one cache line per shard of threads
+      std::atomic< long > allocated{ 0 }; // nodes created for the pool
+      std::atomic< long > live{ 0 }; // nodes out of the free list
+    };
+    // kept off the queue object: queues on a pool share the pool's, so many small queues pay for one
+    struct counter_block {
+      node_counter shards[ counter_shards ];
+      std::atomic< std::size_t > peak_live{ 0 };
+    };
+  public:
+    /* Free nodes shared by any number of queues with the same T and K, so nodes freed by idle
+       queues serve busy ones. Free lists are sharded by thread: a thread returns nodes to its
+       own shard and takes from it first, then from the others. Must outlive its queues.
+    */
+    class pool {
+      friend class _priority_queue;
+      static constexpr std::size_t shard_count = 16;
+      struct alignas( 64 ) shard {
+	std::atomic< Node * > free_list{ nullptr };
+	std::atomic< long > free{ 0 }; // may dip below zero while a take overtakes the push's increment
+      };
+      shard shards[ shard_count ];
+      std::atomic< long > allocated{ 0 };
+      counter_block counters; // of every queue on the pool
+
+      shard & local_shard( ) {
+	return shards[ shard_index( ) % shard_count ];
+      };
+    public:
+      pool( ) = default;
+      pool( pool & ) = delete;
+      ~pool( ) {
+	for ( shard &s : shards ) {
+	  std::unique_ptr< Node > node( s.free_list.load( ) );
+	  while ( node ) { node.reset( node->next ); };
+	}
+      };
+
+      void reserve( std::size_t size ) {
+	shard &local = local_shard( );
+	for ( std::size_t i = 0; i < size; ++i ) {
+	  Node *node = new Node( );
+	  node->counter = claimed_bit;
+	  push_free( local.free_list, node );
+	}
+	allocated.fetch_add( size, std::memory_order_relaxed );
+	local.free.fetch_add( size, std::memory_order_relaxed );
+      };
+      // racy but cheap
+      std::size_t free_nodes( ) const {
+	long free = 0;
+	for ( const shard &s : shards ) free += s.free.load( std::memory_order_relaxed );
+	return std::max( free, 0L );
+      };
+      std::size_t allocated_nodes( ) const {
+	return allocated.load( std::memory_order_relaxed );
+      };
+    };
+  protected:
 
     std::atomic< Node * > free_list, head;
     Node *tail;
+    pool *shared = nullptr; // free nodes go there instead of free_list
+    std::unique_ptr< counter_block > own_counters; // only without a pool
+    counter_block *counters;
+#if defined LOCKFREE_SOJOURN
+  public:
+    static constexpr std::size_t sojourn_buckets = 40; // bucket i counts waits of [ 2^i, 2^( i + 1 ) ) ns, the last one longer too
+  protected:
+    struct alignas( 64 ) sojourn_counter {
+      std::atomic< std::uint64_t > buckets[ sojourn_buckets ] = { };
+    };
+    struct sojourn_block { // per queue even on a pool, as each queue judges its own waits
+      sojourn_counter shards[ counter_shards ];
+    };
+    std::unique_ptr< sojourn_block > sojourns;
+#endif
+
+    node_counter & local_counter( ) {
+      return counters->shards[ shard_index( ) % counter_shards ];
+    };
+    long total_live( ) const {
+      long live = 0;
+      for ( const node_counter &counter : counters->shards ) live += counter.live.load( std::memory_order_relaxed );
+      return live;
+    };
+    void sample_peak( ) {
+      std::size_t live = std::max( total_live( ), 0L ), peak = counters->peak_live.load( std::memory_order_relaxed );
+      while ( live > peak && !counters->peak_live.compare_exchange_weak( peak, live, std::memory_order_relaxed ) );
+    };
 
     template< class U >
     static inline U * get_marked( U *i ) {
@@ -42,8 +220,27 @@ namespace lockfree {
     static inline bool is_marked( U *i ) {
       return ( reinterpret_cast< uintptr_t >( i ) & 1 ); // 0x00000001
     };
+    // held nodes are linked and visible but cannot be claimed: their value points at a tag no payload
+    // can share and the payload waits in stash, so payloads need no pointer bits beyond the mark
+    static T * held_tag( ) {
+      alignas( std::max_align_t ) static char tag;
+      return reinterpret_cast< T * >( &tag );
+    };
+    static inline bool is_held( T *i ) {
+      return i == held_tag( );
+    };
+    // swap value for the held tag, stashing it -- fails if value changed
+    static bool hold( Node *node, T *value ) {
+      node->stash = value; // any two holders of one node stash the same payload
+      return node->value.compare_exchange_strong( value, held_tag( ) );
+    };
 
-    _priority_queue( ) = default;
+    explicit _priority_queue( pool *nodes = nullptr )
+      : shared( nodes ), own_counters( nodes ? nullptr : new counter_block ), counters( nodes ? &nodes->counters : own_counters.get( ) )
+#if defined LOCKFREE_SOJOURN
+      , sojourns( new sojourn_block )
+#endif
+    { };
     _priority_queue( _priority_queue & ) = delete; // non-copyable
 
     // increase ref count -- if marked, then node is unsafe
@@ -53,48 +250,70 @@ namespace lockfree {
 	if ( !read ) return nullptr; // node doesn't exist
 	if ( is_marked( read ) ) return nullptr; // node is marked for deletion
 
-	read->counter += 1;
+	read->counter += one_ref;
 	if ( read == node ) return read; // node didn't change during update so we have it
 	release( read ); // read the wrong thing, so put it back
       }
     };
     // reclaim a node for the free list
     void reclaim( Node *node ) {
-      Node *free_ptr;
-      do {
-	free_ptr = free_list;
-	node->next = free_ptr; // add it to the front of the list
-      } while ( !free_list.compare_exchange_weak( free_ptr, node ) );
+      local_counter( ).live.fetch_sub( 1, std::memory_order_relaxed );
+      if ( !shared ) return push_free( free_list, node );
+      typename pool::shard &local = shared->local_shard( );
+      local.free.fetch_add( 1, std::memory_order_relaxed );
+      push_free( local.free_list, node );
     };
     // decrease ref count -- if necessary, destroy node
     void release( Node *node ) {
       int old_counter, new_counter;
       if ( !node ) return;
 
-      do { // decrement counter and mark for reclaim if needed
+      do { // decrement counter and claim for reclaim if it was the last reference
 	old_counter = node->counter;
-	new_counter = old_counter - 1;
+	new_counter = old_counter == one_ref ? claimed_bit : old_counter - one_ref;
       } while ( !node->counter.compare_exchange_weak( old_counter, new_counter ) );
-      if ( new_counter ) return; // if not claimed this round
+      if ( old_counter != one_ref ) return; // still referenced, or already claimed and only a stale prev hint let go
 
       release( get_unmarked( node->next.load( ) ) ); // release next
       reclaim( node );
     };
 
+    // check a node out of a free list, or nullptr if it is empty
+    Node * take_free( std::atomic< Node * > &list ) {
+      Node *node, *free_ptr;
+      while ( ( node = free_ptr = safe_read( list ) ) ) { // free_ptr may be changed by cxw
+	if ( list.compare_exchange_weak( free_ptr, free_ptr->next ) ) return node; // our safe_read reference is the caller's
+	release( node ); // someone else already checked this one out
+      }
+      return nullptr;
+    };
     Node * get_new_node( T *value, K key ) {
-      while ( true ) {
-	Node *new_node, *free_ptr;
-	new_node = free_ptr = safe_read( free_list ); // free_ptr may be changed by cxw
-	if ( !new_node ) return new Node( key, value ); // this may be blocking
-	if ( free_list.compare_exchange_weak( free_ptr, free_ptr->next ) ) {
-	  new_node->counter += 1;
-	  new_node->key = key;
-	  new_node->value = value;
-	  return new_node;
-	} else {
-	  release( new_node ); // someone else already checked this one out
-	}
+      Node *new_node = shared ? nullptr : take_free( free_list );
+      for ( std::size_t i = 0; shared && !new_node && i < pool::shard_count; ++i ) { // own shard first
+	typename pool::shard &s = shared->shards[ ( shard_index( ) + i ) % pool::shard_count ];
+	if ( ( new_node = take_free( s.free_list ) ) ) s.free.fetch_sub( 1, std::memory_order_relaxed );
+      }
+      if ( !new_node ) { // this may be blocking
+	LOCKFREE_PROBE2( node_alloc, this, sizeof( Node ) );
+	new_node = new Node( key, value );
+	new_node->counter = one_ref | claimed_bit;
+	new_node->owner = this;
+	local_counter( ).allocated.fetch_add( 1, std::memory_order_relaxed );
+	local_counter( ).live.fetch_add( 1, std::memory_order_relaxed );
+	if ( shared ) shared->allocated.fetch_add( 1, std::memory_order_relaxed );
+	sample_peak( ); // the pool is dry, so this is a high water mark
+	return new_node;
       }
+      local_counter( ).live.fetch_add( 1, std::memory_order_relaxed );
+      new_node->next = nullptr; // not linked until insert publishes it
+      new_node->key = key;
+      new_node->value = value;
+      new_node->owner = this; // before it is published
+      return new_node;
+    };
+    // whether a hint, referenced, is a live node of this queue -- claimed before owner, as a published node keeps its owner while referenced
+    bool live_here( Node *node ) {
+      return !is_claimed( node ) && node->owner.load( ) == this;
     };
     Node * help_delete( Node *node ) {
       Node *next, *cxw, *prev = nullptr, *node_tmp = nullptr;
@@ -102,8 +321,23 @@ namespace lockfree {
       do { // make sure next link is marked
 	next = node->next;
       } while ( !is_marked( next ) && !node->next.compare_exchange_weak( next, get_marked( next ) ) );
+      LOCKFREE_PREEMPTION_POINT( ); // marked but still linked
       next = get_unmarked( next );
       if ( !next ) return safe_read( head ); // someone else already cleaned up
+      LOCKFREE_PROBE2( help_delete, this, node );
+      if ( ( prev = safe_read( node->prev ) ) ) { // try the predecessor hint before walking from head
+	cxw = node;
+	// read the link before the claim flag: a reclaim sets claimed before it reuses next
+	if ( prev->next.load( ) == node && live_here( prev ) && prev->next.compare_exchange_strong( cxw, next ) ) {
+	  node->next = reinterpret_cast< Node * >( 1 ); // no extra ref to next
+	  next->prev = prev;
+	  release( node ); // prev's reference to node
+	  return prev;
+	}
+	release( prev );
+	prev = nullptr;
+      }
+      LOCKFREE_PROBE2( help_delete_walk, this, node ); // stale hint, so walk from head
       do {
 	release( prev );
 	release( node_tmp );
@@ -117,32 +351,47 @@ namespace lockfree {
 	cxw = node;
       } while ( node_tmp == node && !( assigned = prev->next.compare_exchange_strong( cxw, next ) ) );
       node->next = reinterpret_cast< Node * >( 1 ); // no extra ref to next
-      if ( assigned ) release( node ); // prev's reference to node
+      if ( assigned ) {
+	next->prev = prev;
+	release( node ); // prev's reference to node
+      }
       release( node_tmp ); // node_tmp used in this function
       return prev; // prev now has incremented count
     };
     // find the next node and return a reference to it
     Node * read_next( Node *node ) {
-      Node *next;
+      Node *next, *prev;
       next = safe_read( node->next );
-      while ( !next ) {
-	node = help_delete( node );
-	next = safe_read( node->next ); // safely read the next link
-	release( node ); // help_delete gave us an extra ref
+      if ( next ) return next;
+      node = help_delete( node ); // help_delete gives us a ref to the predecessor
+      while ( !( next = safe_read( node->next ) ) ) { // safely read the next link
+	prev = help_delete( node ); // keep our ref to node until help_delete is done with it
+	release( node );
+	node = prev;
       }
+      release( node );
       return next;
     };
-
-#if defined DEBUG
-    friend struct _priority_queue_test;
-#endif
-  public:
-    void insert( T *value, K key ) {
+    // link a new node in place and return it, still referenced
+    // start, if given, is a referenced node no worse than key to walk from instead of head
+    Node * insert_node( T *value, K key, Node *start = nullptr ) {
+      return link_node( get_new_node( value, key ), start ); // starts referenced
+    };
+    // link a node fresh from get_new_node, or in the same state
+    Node * link_node( Node *new_node, Node *start ) {
       Node *prev, *node, *node_cxw;
-      Node *new_node = get_new_node( value, key ); // starts referenced
+      K key = new_node->key;
       bool inserted;
+      stamp( new_node );
+      unsigned retries = 0;
+      new_node->counter += one_ref; // our own reference until it is published
       do {
-	prev = safe_read( head );
+	if ( start && !is_marked( start->next.load( ) ) ) { // resume from start unless it is being deleted
+	  prev = start;
+	  prev->counter += one_ref;
+	} else {
+	  prev = safe_read( head );
+	}
 	node = read_next( prev ); // start with head and next
 	while ( !( key > node->key ) && node != tail ) { // find and check out the two nodes surrounding the insertion point
 	  release( prev );
@@ -150,65 +399,597 @@ namespace lockfree {
 	  node = read_next( prev );
 	} 
 	new_node->next = node; // steal prev's reference to node
+	new_node->prev = prev;
 	node_cxw = node;
+	LOCKFREE_PREEMPTION_POINT( );
 	inserted = prev->next.compare_exchange_weak( node_cxw, new_node ); // insert, on failure retry
+	if ( inserted ) node->prev = new_node;
 	release( prev );
 	release( node );
+	if ( !inserted ) ++retries;
       } while ( !inserted );
+      if ( retries ) LOCKFREE_PROBE2( insert_retry, this, retries );
+      new_node->counter -= claimed_bit; // published, so prev hints may unlink through it
+      return new_node;
+    };
+    // mark node's value as popped -- fails if it already was or the node is held
+    static bool claim( Node *node, T *&ret ) {
+      ret = node->value.load( );
+      LOCKFREE_PREEMPTION_POINT( );
+      while ( !is_marked( ret ) && !is_held( ret ) ) {
+	if ( node->value.compare_exchange_weak( ret, get_marked( ret ) ) ) return true;
+      }
+      return false;
+    };
+    static std::uint64_t steady_ns( ) {
+      return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+    };
+#if defined LOCKFREE_SOJOURN
+    static void stamp( Node *node ) {
+      node->enqueued = steady_ns( );
+    };
+    // count how long a node just claimed waited, and return it in ns
+    std::uint64_t record_sojourn( Node *node ) {
+      std::uint64_t now = steady_ns( ), waited = now > node->enqueued ? now - node->enqueued : 0;
+      std::size_t bucket = 0;
+#if defined __GNUC__
+      if ( waited ) bucket = 63 - __builtin_clzll( waited );
+#else
+      while ( waited >> ( bucket + 1 ) ) ++bucket;
+#endif
+      sojourns->shards[ shard_index( ) % counter_shards ].buckets[ std::min( bucket, sojourn_buckets - 1 ) ].fetch_add( 1, std::memory_order_relaxed );
+      return waited;
+    };
+#else
+    static void stamp( Node * ) { };
+    std::uint64_t record_sojourn( Node * ) { return 0; };
+#endif
+    // end a lease that ran out and make its item claimable again -- whoever clears the deadline owns the value
+    // a node is only leased again after this, so later deadlines are always greater and a stale ack cannot match
+    // now is read on first use, once per walk
+    static bool revoke_expired( Node *node, std::uint64_t &now ) {
+      std::uint64_t deadline = node->lease.load( );
+      if ( !deadline ) return false; // mid-transfer, or not leased yet
+      if ( !now ) now = steady_ns( );
+      if ( now <= deadline || !node->lease.compare_exchange_strong( deadline, 0 ) ) return false;
+      node->value = node->stash.load( );
+      return true;
+    };
+    // the first node that can be claimed -- tail when there is none
+    Node * read_first( ) {
+      Node *node, *next, *prev;
+      T *value;
+      std::uint64_t now = 0;
+      node = read_next( head );
+      while ( node != tail && ( is_marked( value = node->value.load( ) ) || is_held( value ) ) ) {
+	if ( is_held( value ) && revoke_expired( node, now ) ) continue; // its lease ran out, so it is back
+	if ( is_held( value ) ) { // mid-transfer or leased, look past it
+	  next = read_next( node );
+	} else {
+	  prev = help_delete( node ); // clear popped nodes off the front, going on from the one before
+	  next = read_next( prev );
+	  release( prev );
+	}
+	release( node );
+	node = next;
+      }
+      return node;
+    };
+    // walk from head to the last node that can be claimed -- head when there is none
+    Node * scan_last( ) {
+      Node *last, *node, *next;
+      T *value;
+      last = safe_read( head );
+      node = read_next( last );
+      node->counter += one_ref; // one reference to walk with, one in case it is the last
+      while ( node != tail ) {
+	if ( is_marked( value = node->value.load( ) ) || is_held( value ) ) {
+	  release( node );
+	} else {
+	  release( last );
+	  last = node;
+	}
+	next = read_next( node );
+	release( node );
+	node = next;
+	node->counter += one_ref;
+      }
+      release( node );
+      release( node );
+      return last;
+    };
+    // walk to the node just before tail -- head when the list is empty
+    Node * read_last( ) {
+      Node *prev, *node;
+      prev = safe_read( tail->prev ); // usually already there
+      if ( !prev || !get_unmarked( prev->next.load( ) ) || !live_here( prev ) ) { // unlinked, free, not yet inserted or in another queue -- link first, as above
+	release( prev );
+	prev = safe_read( head );
+      }
+      while ( ( node = read_next( prev ) ) != tail ) {
+	release( prev );
+	prev = node;
+      }
+      release( node );
+      return prev;
+    };
+    // merge items sorted best first into the list with plain stores -- no concurrent access
+    template< class Iterator >
+    void link_sorted( Iterator first, Iterator last ) {
+      Node *prev = head, *node = get_unmarked( prev->next.load( ) ), *new_node;
+      for ( ; first != last; ++first ) {
+	K key = first->second;
+	while ( node != tail && !( key > node->key ) ) { // same position insert would pick
+	  prev = node;
+	  node = get_unmarked( node->next.load( std::memory_order_relaxed ) );
+	}
+	new_node = get_new_node( first->first, key ); // its reference becomes prev's link
+	new_node->next.store( node, std::memory_order_relaxed );
+	new_node->prev.store( prev, std::memory_order_relaxed );
+	new_node->counter.fetch_sub( claimed_bit, std::memory_order_relaxed );
+	stamp( new_node );
+	prev->next.store( new_node, std::memory_order_relaxed );
+	node->prev.store( new_node, std::memory_order_relaxed );
+	prev = new_node;
+      }
+      std::atomic_thread_fence( std::memory_order_release ); // publish the whole chain at once
+    };
+
+#if defined DEBUG
+    friend struct _priority_queue_test;
+#endif
+  public:
+    typedef T value_type;
+    typedef K key_type;
+
+    // an item handed out by lease_pop, which stays in the queue until ack or requeue
+    class lease {
+      friend class _priority_queue;
+      Node *node = nullptr; // nodes are never freed while the queue lives, so a stale one is harmless
+      std::uint64_t deadline = 0;
+    public:
+      T *value = nullptr;
+      explicit operator bool( ) const { return value; };
+    };
+
+    void insert( T *value, K key ) {
+      release( insert_node( value, key ) );
+    };
+    // insert a range of ( T *, K ) pairs, sorted best first so each walk resumes from the item before it
+    // safe against concurrent access, unlike assign
+    template< class InputIt >
+    void insert_bulk( InputIt first, InputIt last ) {
+      std::vector< std::pair< T *, K > > items( first, last );
+      auto better = [ ]( const std::pair< T *, K > &a, const std::pair< T *, K > &b ) { return a.second > b.second; };
+      Node *prev = nullptr, *node;
+      if ( !std::is_sorted( items.begin( ), items.end( ), better ) ) std::stable_sort( items.begin( ), items.end( ), better );
+      for ( const std::pair< T *, K > &item : items ) {
+	node = insert_node( item.first, item.second, prev );
+	release( prev );
+	prev = node;
+      }
+      release( prev );
     };
 
     T * pop( K key ) {
+      std::uint64_t waited;
+      return pop_measured( key, waited );
+    };
+    // pop( key ), also returning how long the item waited in ns -- always 0 without LOCKFREE_SOJOURN
+    T * pop_measured( K key, std::uint64_t &waited ) {
       Node *ret_node;
       T *ret;
-      while ( ( ret_node = read_next( head ) ) ) {
+      waited = 0;
+      while ( ( ret_node = read_first( ) ) ) {
 	if ( key > ret_node->key || ret_node == tail ) { // if we reach the tail or low priority then abort
 	  release( ret_node );
 	  return nullptr;
 	}
-	ret = get_unmarked( ret_node->value ); // otherwise, we attempt to get an unmarked value
-	if ( ret_node->value.compare_exchange_strong( ret, get_marked( ret ) ) ) {
+	if ( claim( ret_node, ret ) ) { // otherwise, we attempt to mark the value
+	  waited = record_sojourn( ret_node );
 	  release( ret_node );
 	  return ret; // success
-	} else { // already marked for deletion
-	  release( help_delete( ret_node ) );
-	  release( ret_node );
 	}
+	release( ret_node ); // someone beat us to it
       }
+      return nullptr; // we should reach tail before this
     };
     T * pop ( ) {
+      std::uint64_t waited;
+      return pop_measured( waited );
+    };
+    // pop( ), also returning how long the item waited in ns -- always 0 without LOCKFREE_SOJOURN
+    T * pop_measured( std::uint64_t &waited ) {
       Node *ret_node;
       T *ret;
-      while ( ( ret_node = read_next( head ) ) ) {
+      unsigned retries = 0;
+      waited = 0;
+      while ( ( ret_node = read_first( ) ) ) {
 	if ( ret_node == tail ) { // if we reach the tail
 	  release( ret_node );
 	  return nullptr;
 	}
-	ret = get_unmarked( ret_node->value.load( ) ); // otherwise, we attempt to get an unmarked value
-	if ( ret_node->value.compare_exchange_strong( ret, get_marked( ret ) ) ) {
+	if ( claim( ret_node, ret ) ) { // otherwise, we attempt to mark the value
+	  waited = record_sojourn( ret_node );
 	  release( ret_node );
+	  if ( retries ) LOCKFREE_PROBE2( pop_retry, this, retries );
 	  return ret; // success
-	} else { // already marked for deletion
-	  release( help_delete( ret_node ) );
-	  release( ret_node );
 	}
+	release( ret_node ); // someone beat us to it
+	++retries;
       }
       return nullptr; // we should reach tail before this
     };
+    // claim the best item and hand f( T *, const K & ) the payload and key while the node is still referenced
+    // f takes ownership of the payload, as the caller of pop would
+    template< class F >
+    bool consume( F &&f ) {
+      Node *node;
+      T *ret;
+      while ( ( node = read_first( ) ) != tail ) {
+	if ( claim( node, ret ) ) {
+	  record_sojourn( node );
+	  f( ret, static_cast< const K & >( node->key ) );
+	  release( node );
+	  return true; // success
+	}
+	release( node ); // someone beat us to it
+      }
+      release( node );
+      return false;
+    };
+    // consume items best first while pred( key ) holds, walking on from each node rather than restarting at head
+    // items inserted ahead of the walk after it passed are left for later
+    template< class P, class F >
+    std::size_t consume_while( P &&pred, F &&f ) {
+      std::size_t consumed = 0;
+      Node *node, *next;
+      T *ret;
+      node = read_first( );
+      while ( node != tail && pred( static_cast< const K & >( node->key ) ) ) {
+	if ( claim( node, ret ) ) { // popped or held nodes are stepped over
+	  record_sojourn( node );
+	  f( ret, static_cast< const K & >( node->key ) );
+	  ++consumed;
+	}
+	next = read_next( node );
+	release( node );
+	node = next;
+      }
+      release( node );
+      return consumed;
+    };
+    // push then pop in one step: value itself if it beats the best item, otherwise the best item, with value inserted
+    // the popped node is unlinked and reused for value unless someone else still holds a reference to it
+    T * pushpop( T *value, K key ) {
+      Node *node;
+      T *ret;
+      int only_ours = one_ref;
+      while ( ( node = read_first( ) ) != tail && !( key > node->key ) ) {
+	if ( claim( node, ret ) ) {
+	  record_sojourn( node );
+	  release( help_delete( node ) ); // unlink it now rather than leave it to the next walk
+	  if ( !node->counter.compare_exchange_strong( only_ours, one_ref | claimed_bit ) ) { // as get_new_node hands it out
+	    release( node );
+	    insert( value, key );
+	    return ret;
+	  }
+	  node->next = nullptr;
+	  node->key = key;
+	  node->value = value;
+	  release( link_node( node, nullptr ) );
+	  return ret;
+	}
+	release( node ); // someone beat us to it
+      }
+      release( node );
+      return value; // empty, or value would come straight back out
+    };
+    // take the best item for timeout: it stays linked but hidden until ack removes it or requeue gives it back,
+    // and if neither comes in time the next walk past it makes it claimable again -- at-least-once delivery
+    // an empty lease if the queue is empty; outstanding leases stay at the front, so walks step past them
+    lease lease_pop( std::chrono::nanoseconds timeout ) {
+      lease ret;
+      Node *node;
+      T *value;
+      while ( ( node = read_first( ) ) != tail ) {
+	value = node->value.load( );
+	if ( !is_marked( value ) && !is_held( value ) && hold( node, value ) ) {
+	  ret.deadline = steady_ns( ) + std::max< std::int64_t >( timeout.count( ), 0 );
+	  node->lease = ret.deadline; // revocable from here on
+	  record_sojourn( node ); // handed out, whatever becomes of the lease
+	  ret.node = node;
+	  ret.value = value;
+	  release( node );
+	  return ret;
+	}
+	release( node ); // someone beat us to it
+      }
+      release( node );
+      return ret;
+    };
+    // remove a leased item for good -- false if it ran out and was revoked first, so it is or was handed out again
+    bool ack( lease &item ) {
+      std::uint64_t deadline = item.deadline;
+      if ( !item.node || !item.node->lease.compare_exchange_strong( deadline, 0 ) ) return false;
+      item.node->value = get_marked( item.value ); // popped, so walks unlink it as usual
+      item.node = nullptr;
+      return true;
+    };
+    // give a leased item back without waiting for it to run out -- false if it already had
+    bool requeue( lease &item ) {
+      std::uint64_t deadline = item.deadline;
+      if ( !item.node || !item.node->lease.compare_exchange_strong( deadline, 0 ) ) return false;
+      item.node->value = item.value;
+      item.node = nullptr;
+      return true;
+    };
+    // claim the best item pred( T *, const K & ) accepts in one walk, trying at most max_scan live items
+    // items passed over stay where they are -- nullptr if none of those tried was accepted
+    template< class P >
+    T * pop_if( P &&pred, std::size_t max_scan = std::numeric_limits< std::size_t >::max( ) ) {
+      Node *node, *next;
+      T *ret;
+      std::uint64_t now = 0;
+      node = read_first( );
+      for ( std::size_t scanned = 0; node != tail && scanned < max_scan; ) {
+	if ( is_held( ret = node->value.load( ) ) && revoke_expired( node, now ) ) ret = node->value.load( );
+	if ( !is_marked( ret ) && !is_held( ret ) ) { // popped or held nodes are stepped over
+	  ++scanned;
+	  if ( pred( ret, static_cast< const K & >( node->key ) ) && claim( node, ret ) ) {
+	    record_sojourn( node );
+	    release( node );
+	    return ret; // success
+	  }
+	}
+	next = read_next( node );
+	release( node );
+	node = next;
+      }
+      release( node );
+      return nullptr;
+    };
+    // remove the lowest priority item -- O(1) while the prev hints hold
+    T * pop_lowest( ) {
+      Node *ret_node;
+      T *ret;
+      while ( ( ret_node = read_last( ) ) != head ) {
+	if ( is_held( ret_node->value.load( ) ) ) { // mid-transfer, so take the slow walk instead
+	  release( ret_node );
+	  if ( ( ret_node = scan_last( ) ) == head ) break;
+	}
+	if ( claim( ret_node, ret ) ) {
+	  record_sojourn( ret_node );
+	  release( ret_node );
+	  return ret; // success
+	}
+	if ( is_marked( ret ) ) release( help_delete( ret_node ) ); // already marked for deletion
+	release( ret_node );
+      }
+      release( ret_node ); // head, so the list is empty
+      return nullptr;
+    };
+
+    // replace the contents with a range of ( T *, K ) pairs in O( n log n ), O( n ) if already sorted best first
+    // not safe against concurrent access -- meant for ( re )building a queue before sharing it
+    template< class InputIt >
+    void assign( InputIt first, InputIt last ) {
+      std::vector< std::pair< T *, K > > items( first, last );
+      auto better = [ ]( const std::pair< T *, K > &a, const std::pair< T *, K > &b ) { return a.second > b.second; };
+      T *item;
+      while ( ( item = pop( ) ) ) { delete item; }; // clear list, as the destructor would
+
+      if ( !std::is_sorted( items.begin( ), items.end( ), better ) ) { // stable, so equal keys keep insertion order
+#if defined LOCKFREE_PARALLEL_SORT
+	std::stable_sort( std::execution::par, items.begin( ), items.end( ), better );
+#else
+	std::stable_sort( items.begin( ), items.end( ), better );
+#endif
+      }
+      link_sorted( items.begin( ), items.end( ) );
+    };
+
+    // pop the best item across several queues of the same type, ties going to the earliest queue
+    template< class... Queues >
+    static T * pop_best_of( _priority_queue &first, Queues &... rest ) {
+      _priority_queue *queues[ ] = { &first, &rest... }, *owner = nullptr;
+      Node *node, *best;
+      T *ret;
+      while ( true ) {
+	best = nullptr;
+	for ( _priority_queue *queue : queues ) { // peek every front, keeping a reference to the best
+	  node = queue->read_first( );
+	  if ( node != queue->tail && ( !best || node->key > best->key ) ) {
+	    if ( best ) owner->release( best );
+	    best = node;
+	    owner = queue;
+	  } else {
+	    queue->release( node );
+	  }
+	}
+	if ( !best ) return nullptr; // all empty
+	if ( claim( best, ret ) ) {
+	  owner->record_sojourn( best );
+	  owner->release( best );
+	  return ret; // success
+	}
+	owner->release( best ); // someone popped it first, so look again
+      }
+    };
+
+    // move the best item of src into dest -- it stays poppable in src until the moment it becomes poppable in dest
+    // dest links a node of its own rather than taking src's: the item must be visible in dest before it leaves src,
+    // and src's node may still be referenced by walkers and hints there until its count drops. On a shared pool
+    // the copy comes from the pool and src's node goes back to it, so steals in steady state allocate nothing
+    static bool steal_best( _priority_queue &src, _priority_queue &dest ) {
+      Node *node, *copy;
+      T *value, *ret;
+      while ( ( node = src.read_first( ) ) != src.tail ) {
+	value = node->value.load( );
+	if ( is_marked( value ) || is_held( value ) ) { // taken or leased since read_first, so look again
+	  src.release( node );
+	  continue;
+	}
+	copy = dest.get_new_node( held_tag( ), node->key );
+	copy->stash = value;
+	copy = dest.link_node( copy, nullptr ); // visible in dest, but nobody can claim it yet
+	if ( claim( node, ret ) ) {
+#if defined LOCKFREE_SOJOURN
+	  copy->enqueued = node->enqueued; // it has been waiting since src got it
+#endif
+	  copy->value = ret; // ours alone while held, so a store hands it over
+	  dest.release( copy );
+	  src.release( node );
+	  return true;
+	}
+	copy->value = get_marked( value ); // src lost it first, so withdraw the copy
+	dest.release( copy );
+	src.release( node );
+      }
+      src.release( node );
+      return false; // src is empty
+    };
+
+    /* Binary checkpoints: a header, then blocks of up to snapshot_block ( key, payload ) records
+       best first, each block prefixed by its record count and the last one empty.
+       Writers take write( const char *, std::streamsize ) and readers read( char *, std::streamsize ),
+       so std::ostream / std::istream work as is. K and T must be trivially copyable.
+
+       The traversal sees every item present for its whole duration exactly once, in order;
+       payloads popped while it runs must not be freed until it returns.
+    */
+    static constexpr char snapshot_magic[ 4 ] = { 'L', 'F', 'P', 'Q' };
+    static constexpr std::uint32_t snapshot_block = 4096;
+
+    template< class Writer >
+    std::size_t snapshot_to( Writer &writer ) {
+      static_assert( std::is_trivially_copyable< K >::value && std::is_trivially_copyable< T >::value,
+		     "snapshots copy keys and payloads bytewise" );
+      const std::size_t record = sizeof( K ) + sizeof( T );
+      std::vector< char > buffer( sizeof( std::uint32_t ) + snapshot_block * record );
+      std::uint32_t count = 0;
+      std::size_t total = 0;
+      char header[ 8 ] = { snapshot_magic[ 0 ], snapshot_magic[ 1 ], snapshot_magic[ 2 ], snapshot_magic[ 3 ],
+			   1, static_cast< char >( sizeof( K ) ), static_cast< char >( sizeof( T ) ), 0 }; // version 1
+      auto flush = [ & ]( ) {
+	std::memcpy( buffer.data( ), &count, sizeof( count ) );
+	writer.write( buffer.data( ), sizeof( count ) + count * record );
+	total += count;
+	count = 0;
+      };
+      Node *node, *next;
+      T *value;
+
+      writer.write( header, sizeof( header ) );
+      node = safe_read( head );
+      while ( ( next = read_next( node ) ) != tail ) {
+	release( node );
+	node = next;
+	if ( is_marked( value = node->value.load( ) ) ) continue; // already popped
+	char *out = buffer.data( ) + sizeof( count ) + count * record;
+	std::memcpy( out, &node->key, sizeof( K ) );
+	std::memcpy( out + sizeof( K ), is_held( value ) ? node->stash.load( ) : value, sizeof( T ) );
+	if ( ++count == snapshot_block ) flush( );
+      }
+      release( next );
+      release( node );
+      if ( count ) flush( );
+      flush( ); // empty block ends the stream
+      return total;
+    };
+
+    // replace the contents with a snapshot in O( n ) -- same restrictions as assign
+    template< class Reader >
+    bool restore_from( Reader &reader ) {
+      static_assert( std::is_trivially_copyable< K >::value && std::is_trivially_copyable< T >::value,
+		     "snapshots copy keys and payloads bytewise" );
+      const std::size_t record = sizeof( K ) + sizeof( T );
+      std::vector< std::pair< T *, K > > items;
+      std::vector< char > buffer;
+      std::uint32_t count;
+      char header[ 8 ];
+      bool ok = true;
+
+      if ( !reader.read( header, sizeof( header ) ) || std::memcmp( header, snapshot_magic, 4 ) || header[ 4 ] != 1 ||
+	   header[ 5 ] != static_cast< char >( sizeof( K ) ) || header[ 6 ] != static_cast< char >( sizeof( T ) ) ) {
+	return false; // not ours, or written for other types
+      }
+      while ( ( ok = bool( reader.read( reinterpret_cast< char * >( &count ), sizeof( count ) ) ) ) && count ) {
+	buffer.resize( count * record );
+	if ( !( ok = bool( reader.read( buffer.data( ), buffer.size( ) ) ) ) ) break;
+	for ( const char *in = buffer.data( ); count; --count, in += record ) {
+	  std::pair< T *, K > item( new T, K( ) );
+	  std::memcpy( &item.second, in, sizeof( K ) );
+	  std::memcpy( item.first, in + sizeof( K ), sizeof( T ) );
+	  items.push_back( item );
+	}
+      }
+      if ( ok ) assign( items.begin( ), items.end( ) ); // already sorted, so this only links
+      else for ( auto &item : items ) delete item.first; // truncated stream
+      return ok;
+    };
 
     void reserve( std::size_t size ) {
-      for ( std::size_t i; i < size; ++i ) {
+      if ( shared ) return shared->reserve( size ); // the pool's, not ours
+      for ( std::size_t i = 0; i < size; ++i ) {
+	local_counter( ).allocated.fetch_add( 1, std::memory_order_relaxed );
+	local_counter( ).live.fetch_add( 1, std::memory_order_relaxed ); // until release reclaims it
 	release( new Node( ) );
       }
       return;
     };
+
+    // a racy but cheap sum of the sharded counters
+    memory_stats memory_usage( ) {
+      memory_stats stats;
+      long allocated = 0, live = 0;
+      for ( const node_counter &counter : counters->shards ) {
+	allocated += counter.allocated.load( std::memory_order_relaxed );
+	live += counter.live.load( std::memory_order_relaxed );
+      }
+      sample_peak( );
+      stats.live_nodes = std::max( live, 0L );
+      stats.free_nodes = shared ? shared->free_nodes( ) : std::max( allocated - live, 0L );
+      stats.peak_live_nodes = std::max( counters->peak_live.load( std::memory_order_relaxed ), stats.live_nodes );
+      stats.pool_bytes = shared ? shared->allocated_nodes( ) * sizeof( Node ) + sizeof( pool ) : std::max( allocated, 0L ) * sizeof( Node ); // shared pools count every queue's
+      stats.sentinel_bytes = 2 * sizeof( Node );
+      stats.counter_bytes = own_counters ? sizeof( counter_block ) : 0;
+#if defined LOCKFREE_SOJOURN
+      stats.counter_bytes += sizeof( sojourn_block );
+#endif
+      stats.bytes = stats.pool_bytes + stats.sentinel_bytes + stats.counter_bytes;
+      return stats;
+    };
+#if defined LOCKFREE_SOJOURN
+    // how many removed items waited how long, per sojourn bucket -- racy but cheap
+    std::array< std::uint64_t, sojourn_buckets > sojourn_histogram( ) const {
+      std::array< std::uint64_t, sojourn_buckets > total = { };
+      for ( const sojourn_counter &counter : sojourns->shards ) {
+	for ( std::size_t i = 0; i < sojourn_buckets; ++i ) total[ i ] += counter.buckets[ i ].load( std::memory_order_relaxed );
+      }
+      return total;
+    };
+    void reset_sojourn_histogram( ) {
+      for ( sojourn_counter &counter : sojourns->shards ) {
+	for ( std::atomic< std::uint64_t > &bucket : counter.buckets ) bucket.store( 0, std::memory_order_relaxed );
+      }
+    };
+#endif
     
     ~_priority_queue( ) {
       T *item;
+      for ( Node *node = get_unmarked( head.load( )->next.load( ) ); node != tail; node = get_unmarked( node->next.load( ) ) ) {
+	if ( is_held( node->value.load( ) ) ) { // leased out, so end the lease for pop to find it
+	  node->lease = 0;
+	  node->value = node->stash.load( );
+	}
+      }
       while ( ( item = pop( ) ) ) { delete item; }; // clear list
 
       delete safe_read( head );
       delete tail;
 
+      if ( shared ) return; // popped nodes went back to the pool
       std::unique_ptr< Node > node( safe_read( free_list ) );
       while( node ) { node.reset( node->next ); }; // clean up nodes
       return;
@@ -218,28 +999,167 @@ namespace lockfree {
   template< typename T, typename K, typename = void >
   class priority_queue : public _priority_queue< T, K > {
     typedef typename _priority_queue< T, K >::Node Node;
-  public:
-    priority_queue( ) : _priority_queue< T, K >( ) {
+
+    explicit priority_queue( typename _priority_queue< T, K >::pool *nodes ) : _priority_queue< T, K >( nodes ) {
       this->free_list = nullptr;
       this->tail = new Node( K::min( ), nullptr );
       Node * new_head = new Node( K::max( ), nullptr );
       new_head->next = this->tail;
+      new_head->owner = this; // head is a valid hint
       this->head = new_head;
     };
+  public:
+    priority_queue( ) : priority_queue( nullptr ) { };
+    template< class InputIt >
+    priority_queue( InputIt first, InputIt last ) : priority_queue( ) {
+      this->assign( first, last );
+    };
+    // nodes come from and go back to nodes, shared with other queues, and so do the node counters
+    explicit priority_queue( typename _priority_queue< T, K >::pool &nodes ) : priority_queue( &nodes ) { };
   };
     
   template< typename T, typename K >
   class priority_queue< T, K, typename std::enable_if< std::is_fundamental< K >::value >::type >
     : public _priority_queue< T, K > {
     typedef typename _priority_queue< T, K >::Node Node;
-  public:
-    priority_queue( ) : _priority_queue< T, K >( ) {
+
+    explicit priority_queue( typename _priority_queue< T, K >::pool *nodes ) : _priority_queue< T, K >( nodes ) {
       this->free_list = nullptr;
       this->tail = new Node( std::numeric_limits< K >::min( ), nullptr );
       Node * new_head = new Node( std::numeric_limits< K >::max( ), nullptr );
       new_head->next = this->tail;
+      new_head->owner = this; // head is a valid hint
       this->head = new_head;
     };
+  public:
+    priority_queue( ) : priority_queue( nullptr ) { };
+    template< class InputIt >
+    priority_queue( InputIt first, InputIt last ) : priority_queue( ) {
+      this->assign( first, last );
+    };
+    // nodes come from and go back to nodes, shared with other queues, and so do the node counters
+    explicit priority_queue( typename _priority_queue< T, K >::pool &nodes ) : priority_queue( &nodes ) { };
   };
   
+  /* Keeps only the capacity best items.
+
+     Once full, the key of the worst item is published as an admission threshold:
+     while full, keys below it are turned away after two loads, and admitting a key
+     evicts the worst item from the tail end. Under concurrent use the threshold
+     may briefly lag, so capacity is a soft bound -- and a stale one only turns
+     keys away while the count says the queue is full.
+
+     Only operations that keep the count are public: bulk loads, restores and
+     moves between queues would bypass admission, so they are not offered.
+  */
+  template< typename T, typename K >
+  class bounded_priority_queue : protected priority_queue< T, K > {
+    typedef _priority_queue< T, K > base;
+    typedef typename base::Node Node;
+
+    const std::size_t capacity;
+    std::atomic< std::size_t > count;
+    std::atomic< K > threshold; // worst key held once full, tail key otherwise -- only trusted while full
+
+    void update_threshold( ) {
+      Node *last = this->read_last( );
+      threshold.store( count.load( ) < capacity || last == this->head ? this->tail->key : last->key,
+		       std::memory_order_relaxed );
+      this->release( last );
+    };
+    // n items left the queue -- the threshold moves once the count drops below capacity
+    void removed( std::size_t n ) {
+      std::size_t before = n ? count.fetch_sub( n ) : 0;
+      if ( before >= capacity && before - n < capacity ) update_threshold( );
+    };
+  public:
+    using typename base::value_type;
+    using typename base::key_type;
+    using typename base::lease;
+    using base::lease_pop; // a leased item still counts until ack
+    using base::requeue;
+    using base::snapshot_to;
+    using base::memory_usage;
+#if defined LOCKFREE_SOJOURN
+    using base::sojourn_histogram;
+    using base::reset_sojourn_histogram;
+#endif
+
+    bounded_priority_queue( std::size_t capacity )
+      : priority_queue< T, K >( ), capacity( capacity ), count( 0 ), threshold( this->tail->key ) { };
+
+    // returns whatever the queue gave up: value if rejected, the evicted item, or nullptr
+    T * insert( T *value, K key ) {
+      T *evicted = nullptr;
+      if ( count.load( ) >= capacity && threshold.load( std::memory_order_relaxed ) > key ) return value; // not among the best
+      _priority_queue< T, K >::insert( value, key );
+      std::size_t held = count.fetch_add( 1 ) + 1;
+      if ( held > capacity && ( evicted = _priority_queue< T, K >::pop_lowest( ) ) ) removed( 1 );
+      if ( held >= capacity ) update_threshold( );
+      return evicted;
+    };
+
+    T * pop( K key ) {
+      T *ret = _priority_queue< T, K >::pop( key );
+      if ( ret ) removed( 1 );
+      return ret;
+    };
+    T * pop( ) {
+      T *ret = _priority_queue< T, K >::pop( );
+      if ( ret ) removed( 1 );
+      return ret;
+    };
+    T * pop_lowest( ) {
+      T *ret = _priority_queue< T, K >::pop_lowest( );
+      if ( ret ) removed( 1 );
+      return ret;
+    };
+    T * pushpop( T *value, K key ) {
+      T *ret = _priority_queue< T, K >::pushpop( value, key );
+      if ( ret != value && count.load( ) >= capacity ) update_threshold( ); // value may be the new worst
+      return ret;
+    };
+    template< class P >
+    T * pop_if( P &&pred, std::size_t max_scan = std::numeric_limits< std::size_t >::max( ) ) {
+      T *ret = _priority_queue< T, K >::pop_if( std::forward< P >( pred ), max_scan );
+      if ( ret ) removed( 1 );
+      return ret;
+    };
+    T * pop_measured( std::uint64_t &waited ) {
+      T *ret = base::pop_measured( waited );
+      if ( ret ) removed( 1 );
+      return ret;
+    };
+    template< class F >
+    bool consume( F &&f ) {
+      bool consumed = base::consume( std::forward< F >( f ) );
+      removed( consumed );
+      return consumed;
+    };
+    template< class P, class F >
+    std::size_t consume_while( P &&pred, F &&f ) {
+      std::size_t consumed = base::consume_while( std::forward< P >( pred ), std::forward< F >( f ) );
+      removed( consumed );
+      return consumed;
+    };
+    bool ack( lease &item ) {
+      bool acked = base::ack( item );
+      removed( acked );
+      return acked;
+    };
+
+    std::size_t size( ) const { return count.load( ); };
+  };
+
+  // lockfree::pop_best_of( a, b, c ) for queues of the same type
+  template< class Queue, class... Queues >
+  inline auto pop_best_of( Queue &first, Queues &... rest ) -> decltype( first.pop( ) ) {
+    return Queue::pop_best_of( first, rest... );
+  };
+
+  template< class Queue >
+  inline bool steal_best( Queue &src, Queue &dest ) {
+    return Queue::steal_best( src, dest );
+  };
+
 }
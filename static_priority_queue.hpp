@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/* The sorted-list priority queue in a fixed block of memory: N nodes embedded
+   in the object and linked by index, so nothing is allocated after
+   construction and the object works in static storage or shared memory.
+
+   Links pack a 32-bit version, a 31-bit node index and a mark bit into one
+   64-bit word, and every change to a link bumps its version. Nodes are
+   recycled straight through a free list, so a walk re-reads the link it came
+   through after reading a node: if it has not changed, the node was still in
+   the list and what was read belongs to it. A CAS on the link of a node that
+   has been recycled since fails on the version.
+
+   Higher keys pop first, equal keys in insertion order, as in priority_queue.
+   insert returns false when all N nodes are in use. Payloads left in the
+   queue are not deleted -- they need not come from the heap either.
+*/
+
+namespace lockfree {
+
+  template< class T, typename K, std::size_t N >
+  class static_priority_queue {
+    static_assert( N > 0 && N < ( std::size_t( 1 ) << 31 ) - 1, "node indices take 31 bits of a link" );
+    static_assert( std::is_trivially_copyable< K >::value, "keys are read while their node may be recycled, so they are kept in atomics" );
+
+    typedef std::uint64_t link;
+    static_assert( std::atomic< link >::is_always_lock_free, "links must be lock-free to share between processes" );
+
+    static constexpr std::uint32_t null = ( std::uint32_t( 1 ) << 31 ) - 1;
+
+    static link make_link( std::uint32_t version, std::uint32_t index, bool marked ) {
+      return link( version ) << 32 | link( index ) << 1 | link( marked );
+    };
+    static std::uint32_t index_of( link l ) {
+      return static_cast< std::uint32_t >( l >> 1 ) & null;
+    };
+    static bool is_marked( link l ) {
+      return l & 1;
+    };
+    // what a link becomes when it is changed to index
+    static link changed( link old, std::uint32_t index, bool marked = false ) {
+      return make_link( static_cast< std::uint32_t >( old >> 32 ) + 1, index, marked );
+    };
+
+    struct Node {
+      std::atomic< K > key;
+      std::atomic< T * > value;
+      std::atomic< link > next; // marked once popped
+      std::atomic< std::uint32_t > free_next; // only meaningful on the free list
+    };
+
+    alignas( 64 ) std::atomic< link > head;
+    alignas( 64 ) std::atomic< link > free_top;
+    alignas( 64 ) Node nodes[ N ];
+
+    void push_free( std::uint32_t index ) {
+      link top = free_top.load( );
+      do {
+	nodes[ index ].free_next = index_of( top );
+      } while ( !free_top.compare_exchange_weak( top, changed( top, index ) ) );
+    };
+    std::uint32_t take_free( ) {
+      link top = free_top.load( );
+      while ( index_of( top ) != null ) {
+	std::uint32_t next = nodes[ index_of( top ) ].free_next.load( ); // may be stale, then the version fails the CAS
+	if ( free_top.compare_exchange_weak( top, changed( top, next ) ) ) return index_of( top );
+      }
+      return null;
+    };
+
+    // the link to swing for key, what it held, and so the first node worse than key -- unlinks popped nodes on the way
+    std::atomic< link > * find( const K &key, link &expected ) {
+      std::atomic< link > *prev = &head;
+      link prev_word = prev->load( ), next_word, replacement;
+      std::uint32_t curr;
+      while ( ( curr = index_of( prev_word ) ) != null ) {
+	Node &node = nodes[ curr ];
+	next_word = node.next.load( );
+	K curr_key = node.key.load( );
+	if ( prev->load( ) != prev_word ) { // curr may have been recycled under us, so start over
+	  prev = &head;
+	  prev_word = prev->load( );
+	  continue;
+	}
+	if ( is_marked( next_word ) ) { // popped, so unlink it on the popper's behalf
+	  replacement = changed( prev_word, index_of( next_word ) );
+	  if ( prev->compare_exchange_strong( prev_word, replacement ) ) {
+	    push_free( curr );
+	    prev_word = replacement;
+	  } else {
+	    prev = &head;
+	    prev_word = prev->load( );
+	  }
+	  continue;
+	}
+	if ( key > curr_key ) break; // equal keys stay in insertion order
+	prev = &node.next;
+	prev_word = next_word;
+      }
+      expected = prev_word;
+      return prev;
+    };
+    // pop the first node, if bound says its key will do
+    template< class Bound >
+    T * pop_first( Bound &&bound ) {
+      link first, next;
+      std::uint32_t index;
+      while ( ( index = index_of( first = head.load( ) ) ) != null ) {
+	Node &node = nodes[ index ];
+	T *value = node.value.load( );
+	K key = node.key.load( );
+	next = node.next.load( );
+	if ( head.load( ) != first ) continue; // node may have been recycled under us
+	if ( is_marked( next ) ) { // popped but still linked
+	  if ( head.compare_exchange_strong( first, changed( first, index_of( next ) ) ) ) push_free( index );
+	  continue;
+	}
+	if ( !bound( key ) ) return nullptr;
+	if ( node.next.compare_exchange_strong( next, changed( next, index_of( next ), true ) ) ) { // it's ours
+	  if ( head.compare_exchange_strong( first, changed( first, index_of( next ) ) ) ) push_free( index ); // or whoever unlinks it does
+	  return value;
+	}
+      }
+      return nullptr;
+    };
+  public:
+    typedef T value_type;
+    typedef K key_type;
+
+    static_priority_queue( ) : head( make_link( 0, null, false ) ), free_top( make_link( 0, 0, false ) ) {
+      for ( std::uint32_t i = 0; i < N; ++i ) {
+	nodes[ i ].next = make_link( 0, null, false );
+	nodes[ i ].free_next = i + 1 < N ? i + 1 : null;
+      }
+    };
+    static_priority_queue( static_priority_queue & ) = delete;
+
+    // false if every node is in use
+    bool insert( T *value, K key ) {
+      std::uint32_t index = take_free( );
+      link expected;
+      std::atomic< link > *prev;
+      if ( index == null ) return false;
+      Node &node = nodes[ index ];
+      node.key = key;
+      node.value = value;
+      do {
+	prev = find( key, expected );
+	node.next = changed( node.next.load( ), index_of( expected ) ); // not yet published, but stale walkers may still look
+      } while ( !prev->compare_exchange_strong( expected, changed( expected, index ) ) );
+      return true;
+    };
+    T * pop( ) {
+      return pop_first( [ ]( const K & ) { return true; } );
+    };
+    // the best item if its key is at least key
+    T * pop( K key ) {
+      return pop_first( [ & ]( const K &first ) { return !( key > first ); } );
+    };
+
+    static constexpr std::size_t capacity( ) {
+      return N;
+    };
+  };
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* Per-thread state for a shared object: each thread takes a slot of its own
+   on first use and gives it back when it exits, for the next new thread to
+   reuse. Up to Count threads hold a slot at once, later ones wait for one to
+   be given back, and anyone can walk the slots handed out so far.
+
+   The slots live in a registry shared with the caches of the threads holding
+   them, so they stay valid for whichever of the owner and a thread goes last.
+*/
+
+namespace lockfree {
+
+  template< class Slot, std::size_t Count >
+  class thread_slots {
+    struct alignas( 64 ) cell { // one cache line or more per thread
+      Slot slot;
+      std::atomic< bool > in_use{ false };
+    };
+    struct registry {
+      cell cells[ Count ];
+      std::atomic< std::size_t > used{ 0 }; // slots ever handed out
+    };
+    // a thread's slots, one per owner it has used, given back when it exits
+    struct thread_cache {
+      std::vector< std::pair< std::shared_ptr< registry >, cell * > > entries;
+      ~thread_cache( ) {
+	for ( auto &entry : entries ) entry.second->in_use = false;
+      };
+    };
+
+    std::shared_ptr< registry > cells{ std::make_shared< registry >( ) };
+  public:
+    static constexpr std::size_t capacity = Count;
+
+    thread_slots( ) = default;
+    thread_slots( thread_slots & ) = delete;
+
+    // the calling thread's slot, taken on first use
+    Slot & local( ) {
+      thread_local thread_cache cache;
+      for ( auto &entry : cache.entries ) {
+	if ( entry.first == cells ) return entry.second->slot;
+      }
+      cache.entries.erase( std::remove_if( cache.entries.begin( ), cache.entries.end( ),
+					   [ ]( const auto &entry ) { return entry.first.use_count( ) == 1; } ), // owner is gone
+			   cache.entries.end( ) );
+      cell *taken = nullptr;
+      while ( !taken ) {
+	std::size_t used = cells->used.load( );
+	for ( std::size_t i = 0; i < used && !taken; ++i ) { // one given back by an exited thread
+	  bool free = false;
+	  if ( cells->cells[ i ].in_use.compare_exchange_strong( free, true ) ) taken = &cells->cells[ i ];
+	}
+	if ( !taken && used < Count && cells->used.compare_exchange_strong( used, used + 1 ) ) {
+	  taken = &cells->cells[ used ];
+	  taken->in_use = true;
+	}
+	if ( !taken ) std::this_thread::yield( ); // every slot taken
+      }
+      cache.entries.emplace_back( cells, taken );
+      return taken->slot;
+    };
+
+    // slots ever handed out, in use or given back -- [ 0, used( ) ) are safe to walk
+    std::size_t used( ) const {
+      return cells->used.load( );
+    };
+    Slot & operator[ ]( std::size_t i ) {
+      return cells->cells[ i ].slot;
+    };
+  };
+
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "thread_slots.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/* Record a queue's real insert / pop / pop( K ) mix and replay it offline.
+
+   recording_queue< Queue > forwards to a queue and logs ( op, key, time ) per thread
+   into a buffer of the thread's own; write_to dumps them as a compact binary trace.
+   Up to max_threads threads record at once, and a thread starting after another
+   has exited carries on its log, so the trace has one thread per concurrent one.
+   replay( trace, queue ) runs one thread per recorded thread against any backend
+   with insert( T *, K ), pop( ) and pop( K ), either paced like the original or flat out.
+
+   Trace: "LFTR", version, sizeof( K ), thread count, then per thread a record count
+   and records of ( nanoseconds since recording began, op, key ).
+*/
+
+namespace lockfree {
+
+  enum class trace_op : std::uint8_t { insert = 0, pop = 1, pop_key = 2 };
+
+  template< typename K >
+  struct trace_record {
+    std::uint64_t time; // ns since the recorder started
+    trace_op op;
+    K key; // unused for pop
+  };
+
+  template< typename K >
+  struct workload_trace {
+    std::vector< std::vector< trace_record< K > > > threads;
+
+    static constexpr std::size_t record_bytes = sizeof( std::uint64_t ) + 1 + sizeof( K );
+    static constexpr std::size_t read_chunk = 4096; // records
+
+    template< class Writer >
+    void write_to( Writer &writer ) const {
+      static_assert( std::is_trivially_copyable< K >::value, "traces copy keys bytewise" );
+      char header[ 8 ] = { 'L', 'F', 'T', 'R', 1, static_cast< char >( sizeof( K ) ), 0, 0 };
+      std::uint32_t count = threads.size( );
+      std::vector< char > buffer;
+      writer.write( header, sizeof( header ) );
+      writer.write( reinterpret_cast< const char * >( &count ), sizeof( count ) );
+      for ( const auto &records : threads ) {
+	std::uint64_t size = records.size( );
+	buffer.resize( size * record_bytes );
+	char *out = buffer.data( );
+	for ( const trace_record< K > &record : records ) {
+	  std::memcpy( out, &record.time, sizeof( record.time ) );
+	  out[ sizeof( record.time ) ] = static_cast< char >( record.op );
+	  std::memcpy( out + sizeof( record.time ) + 1, &record.key, sizeof( K ) );
+	  out += record_bytes;
+	}
+	writer.write( reinterpret_cast< const char * >( &size ), sizeof( size ) );
+	writer.write( buffer.data( ), buffer.size( ) );
+      }
+    };
+
+    template< class Reader >
+    bool read_from( Reader &reader ) {
+      static_assert( std::is_trivially_copyable< K >::value, "traces copy keys bytewise" );
+      char header[ 8 ];
+      std::uint32_t count;
+      std::vector< char > buffer;
+      threads.clear( );
+      if ( !reader.read( header, sizeof( header ) ) || std::memcmp( header, "LFTR", 4 ) || header[ 4 ] != 1 ||
+	   header[ 5 ] != static_cast< char >( sizeof( K ) ) || !reader.read( reinterpret_cast< char * >( &count ), sizeof( count ) ) ) {
+	return false; // not a trace, or recorded with another key type
+      }
+      for ( std::uint32_t i = 0; i < count; ++i ) { // grown as read, so a corrupt count or size runs out of input before memory
+	std::uint64_t size;
+	if ( !reader.read( reinterpret_cast< char * >( &size ), sizeof( size ) ) ) return false;
+	threads.emplace_back( );
+	std::vector< trace_record< K > > &records = threads.back( );
+	while ( records.size( ) < size ) {
+	  std::size_t chunk = std::min< std::uint64_t >( size - records.size( ), read_chunk );
+	  buffer.resize( chunk * record_bytes );
+	  if ( !reader.read( buffer.data( ), buffer.size( ) ) ) return false;
+	  const char *in = buffer.data( );
+	  for ( std::size_t j = 0; j < chunk; ++j, in += record_bytes ) {
+	    trace_record< K > record;
+	    std::memcpy( &record.time, in, sizeof( record.time ) );
+	    record.op = static_cast< trace_op >( in[ sizeof( record.time ) ] );
+	    std::memcpy( &record.key, in + sizeof( record.time ) + 1, sizeof( K ) );
+	    records.push_back( record );
+	  }
+	}
+      }
+      return true;
+    };
+
+    std::size_t operations( ) const {
+      std::size_t total = 0;
+      for ( const auto &records : threads ) total += records.size( );
+      return total;
+    };
+  };
+
+  template< class Queue >
+  class recording_queue {
+    typedef typename Queue::value_type T;
+    typedef typename Queue::key_type K;
+    typedef std::chrono::steady_clock clock;
+
+    struct thread_log {
+      std::vector< trace_record< K > > records;
+    };
+    static constexpr std::size_t max_threads = 256;
+
+    Queue &queue;
+    const clock::time_point start;
+    thread_slots< thread_log, max_threads > logs;
+
+    void record( trace_op op, K key ) {
+      std::uint64_t time = std::chrono::duration_cast< std::chrono::nanoseconds >( clock::now( ) - start ).count( );
+      logs.local( ).records.push_back( trace_record< K >{ time, op, key } );
+    };
+  public:
+    typedef T value_type;
+    typedef K key_type;
+
+    recording_queue( Queue &queue ) : queue( queue ), start( clock::now( ) ) { };
+
+    void insert( T *value, K key ) {
+      record( trace_op::insert, key );
+      queue.insert( value, key );
+    };
+    T * pop( K key ) {
+      record( trace_op::pop_key, key );
+      return queue.pop( key );
+    };
+    T * pop( ) {
+      record( trace_op::pop, K( ) );
+      return queue.pop( );
+    };
+
+    // collect what has been recorded so far -- call once the recording threads are quiet
+    workload_trace< K > trace( ) {
+      workload_trace< K > result;
+      for ( std::size_t i = 0; i < logs.used( ); ++i ) result.threads.push_back( logs[ i ].records );
+      return result;
+    };
+  };
+
+  struct replay_result {
+    double seconds; // from the first operation to the last thread finishing
+    std::size_t operations;
+    std::size_t empty_pops; // pops that found nothing to return
+    double lag; // paced replays: mean ns each operation started behind schedule
+  };
+
+  // replay a trace against queue, one thread per recorded thread; paced keeps the original inter-arrival times
+  template< class Queue, typename K >
+  replay_result replay( const workload_trace< K > &trace, Queue &queue, bool paced = false ) {
+    typedef typename Queue::value_type T;
+    typedef std::chrono::steady_clock clock;
+    std::vector< std::thread > threads;
+    std::vector< std::vector< T > > payloads( trace.threads.size( ) ); // allocated up front, off the clock
+    std::atomic< std::size_t > empty( 0 ), ready( 0 );
+    std::atomic< long long > lag( 0 );
+    std::atomic< bool > go( false );
+    clock::time_point start;
+
+    for ( std::size_t i = 0; i < trace.threads.size( ); ++i ) {
+      std::size_t inserts = 0;
+      for ( const trace_record< K > &record : trace.threads[ i ] ) inserts += record.op == trace_op::insert;
+      payloads[ i ].resize( inserts );
+    }
+    for ( std::size_t i = 0; i < trace.threads.size( ); ++i ) {
+      threads.emplace_back( [ & ]( std::size_t thread ) {
+	  std::size_t inserted = 0, missed = 0;
+	  long long behind = 0;
+	  ready += 1;
+	  while ( !go.load( std::memory_order_acquire ) ) std::this_thread::yield( );
+	  for ( const trace_record< K > &record : trace.threads[ thread ] ) {
+	    if ( paced ) {
+	      clock::time_point due = start + std::chrono::nanoseconds( record.time );
+	      clock::time_point now = clock::now( );
+	      if ( now < due ) std::this_thread::sleep_until( due );
+	      else behind += std::chrono::duration_cast< std::chrono::nanoseconds >( now - due ).count( );
+	    }
+	    switch ( record.op ) {
+	    case trace_op::insert: queue.insert( &payloads[ thread ][ inserted++ ], record.key ); break;
+	    case trace_op::pop: missed += !queue.pop( ); break;
+	    case trace_op::pop_key: missed += !queue.pop( record.key ); break;
+	    }
+	  }
+	  empty += missed;
+	  lag += behind;
+	}, i );
+    }
+    while ( ready.load( ) < threads.size( ) ) std::this_thread::yield( );
+    start = clock::now( );
+    go.store( true, std::memory_order_release );
+    for ( std::thread &thread : threads ) thread.join( );
+
+    replay_result result;
+    result.seconds = std::chrono::duration< double >( clock::now( ) - start ).count( );
+    result.operations = trace.operations( );
+    result.empty_pops = empty.load( );
+    result.lag = paced && result.operations ? double( lag.load( ) ) / result.operations : 0;
+    while ( queue.pop( ) ); // payloads belong to the replay, so drain before they go
+    return result;
+  };
+
+}